@@ -0,0 +1,33 @@
+#include "arena.h"
+#include <cstdint>
+#include <algorithm>
+
+using namespace std;
+
+// Size of the blocks nodes are carved from; larger requests get a block of
+// their own.
+static const size_t ARENA_BLOCK_SIZE = 64 * 1024;
+
+Arena::~Arena()
+{
+    for (auto it = destructors.rbegin(); it != destructors.rend(); ++it)
+    {
+        it->destroy(it->object);
+    }
+}
+
+void *Arena::allocate(size_t size, size_t align)
+{
+    uintptr_t start = ((uintptr_t)cursor + align - 1) & ~(uintptr_t)(align - 1);
+    if (cursor == nullptr || start + size > (uintptr_t)limit)
+    {
+        size_t block_size = max(ARENA_BLOCK_SIZE, size + align);
+        blocks.emplace_back(new char[block_size]);
+        cursor = blocks.back().get();
+        limit = cursor + block_size;
+        start = ((uintptr_t)cursor + align - 1) & ~(uintptr_t)(align - 1);
+    }
+    cursor = (char *)(start + size);
+    used += size;
+    return (void *)start;
+}
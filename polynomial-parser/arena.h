@@ -0,0 +1,53 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// Bump allocator for the nodes of one parse. Nodes are carved out of large
+// blocks in the order they are created, so a tree built in one pass lies
+// contiguously in memory. Nothing is freed on its own: the destructor runs
+// the destructors of the nodes that need one, newest first, and then
+// releases all blocks at once.
+class Arena
+{
+public:
+    Arena() = default;
+    ~Arena();
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    // Returns a value-initialized T that lives as long as the arena.
+    template <class T>
+    T *make()
+    {
+        T *object = new (allocate(sizeof(T), alignof(T))) T();
+        if (!std::is_trivially_destructible<T>::value)
+        {
+            destructors.push_back({object, [](void *p) { static_cast<T *>(p)->~T(); }});
+        }
+        return object;
+    }
+
+    size_t bytes_used() const { return used; }
+
+private:
+    struct Destructor
+    {
+        void *object;
+        void (*destroy)(void *);
+    };
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char *cursor = nullptr;
+    char *limit = nullptr;
+    size_t used = 0;
+    std::vector<Destructor> destructors;
+
+    void *allocate(size_t size, size_t align);
+};
+
+#endif
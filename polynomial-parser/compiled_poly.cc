@@ -0,0 +1,339 @@
+#include "compiled_poly.h"
+#include <algorithm>
+#include <utility>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAVE_X86_KERNELS 1
+#endif
+
+using namespace std;
+
+// Tuples are evaluated in blocks of this many lanes so that the power
+// slots of a block stay in cache.
+static const size_t BLOCK = 256;
+
+// --- Lane kernels ---
+// Each kernel works on n lanes of 32-bit values; multiplication keeps the
+// low 32 bits, so the signed and unsigned results agree.
+
+struct LaneKernels
+{
+    const char *name;
+    void (*mul_into)(uint32_t *dst, const uint32_t *src, size_t n);
+    void (*scale)(uint32_t *dst, const uint32_t *src, uint32_t c, size_t n);
+    void (*add_into)(uint32_t *dst, const uint32_t *src, size_t n);
+};
+
+static void mul_into_scalar(uint32_t *dst, const uint32_t *src, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        dst[i] *= src[i];
+    }
+}
+
+static void scale_scalar(uint32_t *dst, const uint32_t *src, uint32_t c, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        dst[i] = src[i] * c;
+    }
+}
+
+static void add_into_scalar(uint32_t *dst, const uint32_t *src, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        dst[i] += src[i];
+    }
+}
+
+#ifdef HAVE_X86_KERNELS
+
+__attribute__((target("avx2"))) static void mul_into_avx2(uint32_t *dst, const uint32_t *src, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(dst + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(src + i));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_mullo_epi32(a, b));
+    }
+    for (; i < n; ++i)
+    {
+        dst[i] *= src[i];
+    }
+}
+
+__attribute__((target("avx2"))) static void scale_avx2(uint32_t *dst, const uint32_t *src, uint32_t c, size_t n)
+{
+    __m256i vc = _mm256_set1_epi32((int)c);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(src + i));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_mullo_epi32(a, vc));
+    }
+    for (; i < n; ++i)
+    {
+        dst[i] = src[i] * c;
+    }
+}
+
+__attribute__((target("avx2"))) static void add_into_avx2(uint32_t *dst, const uint32_t *src, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(dst + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(src + i));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_add_epi32(a, b));
+    }
+    for (; i < n; ++i)
+    {
+        dst[i] += src[i];
+    }
+}
+
+__attribute__((target("sse4.1"))) static void mul_into_sse41(uint32_t *dst, const uint32_t *src, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(dst + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_mullo_epi32(a, b));
+    }
+    for (; i < n; ++i)
+    {
+        dst[i] *= src[i];
+    }
+}
+
+__attribute__((target("sse4.1"))) static void scale_sse41(uint32_t *dst, const uint32_t *src, uint32_t c, size_t n)
+{
+    __m128i vc = _mm_set1_epi32((int)c);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_mullo_epi32(a, vc));
+    }
+    for (; i < n; ++i)
+    {
+        dst[i] = src[i] * c;
+    }
+}
+
+__attribute__((target("sse4.1"))) static void add_into_sse41(uint32_t *dst, const uint32_t *src, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(dst + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_add_epi32(a, b));
+    }
+    for (; i < n; ++i)
+    {
+        dst[i] += src[i];
+    }
+}
+
+#endif
+
+static LaneKernels pick_kernels()
+{
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return {"avx2", mul_into_avx2, scale_avx2, add_into_avx2};
+    }
+    if (__builtin_cpu_supports("sse4.1"))
+    {
+        return {"sse4.1", mul_into_sse41, scale_sse41, add_into_sse41};
+    }
+#endif
+    return {"scalar", mul_into_scalar, scale_scalar, add_into_scalar};
+}
+
+static const LaneKernels &kernels()
+{
+    static const LaneKernels picked = pick_kernels();
+    return picked;
+}
+
+const char *batch_kernel_name()
+{
+    return kernels().name;
+}
+
+// --- Fixed-arity kernels ---
+// A term is its coefficient times one table lookup per argument; the
+// products are spelled out for each arity so the loop over the arguments
+// disappears and the exponent row is read with constant offsets.
+
+void specialize_fixed_arity(CompiledPoly &p)
+{
+    p.fixed_exponents.clear();
+    p.fixed_max_exponent = 0;
+    if (p.arity == 0 || p.arity > FIXED_MAX_ARITY)
+    {
+        return;
+    }
+    for (int e : p.slot_exp)
+    {
+        if (e > FIXED_MAX_EXPONENT)
+        {
+            return;
+        }
+        p.fixed_max_exponent = max(p.fixed_max_exponent, e);
+    }
+    p.fixed_exponents.assign(p.coefficients.size() * p.arity, 0);
+    for (size_t t = 0; t < p.coefficients.size(); ++t)
+    {
+        for (uint32_t k = p.term_start[t]; k < p.term_start[t + 1]; ++k)
+        {
+            uint32_t slot = p.term_slots[k];
+            p.fixed_exponents[t * p.arity + p.slot_var[slot]] = (uint8_t)p.slot_exp[slot];
+        }
+    }
+}
+
+typedef uint32_t PowerTable[FIXED_MAX_EXPONENT + 1];
+
+template <size_t... I>
+static inline uint32_t fixed_term(uint32_t coefficient, const PowerTable *powers, const uint8_t *exponents,
+                                  index_sequence<I...>)
+{
+    return (coefficient * ... * powers[I][exponents[I]]);
+}
+
+template <size_t N>
+static int eval_fixed(const CompiledPoly &p, const int *args)
+{
+    PowerTable powers[N];
+    for (size_t i = 0; i < N; ++i)
+    {
+        uint32_t x = (uint32_t)args[i];
+        powers[i][0] = 1;
+        for (int e = 1; e <= p.fixed_max_exponent; ++e)
+        {
+            powers[i][e] = powers[i][e - 1] * x;
+        }
+    }
+
+    uint32_t total = 0;
+    const uint8_t *exponents = p.fixed_exponents.data();
+    for (size_t t = 0; t < p.coefficients.size(); ++t, exponents += N)
+    {
+        total += fixed_term(p.coefficients[t], powers, exponents, make_index_sequence<N>());
+    }
+    return (int)total;
+}
+
+static int (*const fixed_kernels[FIXED_MAX_ARITY + 1])(const CompiledPoly &, const int *) = {
+    nullptr, eval_fixed<1>, eval_fixed<2>, eval_fixed<3>, eval_fixed<4>,
+    eval_fixed<5>, eval_fixed<6>, eval_fixed<7>, eval_fixed<8>};
+
+// --- Evaluation ---
+
+int eval_compiled(const CompiledPoly &p, const int *args)
+{
+    if (!p.fixed_exponents.empty())
+    {
+        return fixed_kernels[p.arity](p, args);
+    }
+    return eval_compiled_slots(p, args);
+}
+
+int eval_compiled_slots(const CompiledPoly &p, const int *args)
+{
+    vector<uint32_t> powers(p.slot_var.size());
+    for (size_t s = 0; s < powers.size(); ++s)
+    {
+        uint32_t result = 1;
+        uint32_t square = (uint32_t)args[p.slot_var[s]];
+        for (int e = p.slot_exp[s]; e > 0; e >>= 1)
+        {
+            if (e & 1)
+            {
+                result *= square;
+            }
+            square *= square;
+        }
+        powers[s] = result;
+    }
+
+    uint32_t total = 0;
+    for (size_t t = 0; t < p.coefficients.size(); ++t)
+    {
+        uint32_t value = p.coefficients[t];
+        for (uint32_t k = p.term_start[t]; k < p.term_start[t + 1]; ++k)
+        {
+            value *= powers[p.term_slots[k]];
+        }
+        total += value;
+    }
+    return (int)total;
+}
+
+void eval_compiled_batch(const CompiledPoly &p, const vector<const int *> &columns, size_t count, int *out)
+{
+    const LaneKernels &k = kernels();
+    size_t num_slots = p.slot_var.size();
+    vector<uint32_t> powers(num_slots * BLOCK);
+    vector<uint32_t> step(BLOCK), square(BLOCK), term(BLOCK), total(BLOCK);
+
+    for (size_t first = 0; first < count; first += BLOCK)
+    {
+        size_t n = min(BLOCK, count - first);
+
+        // Slot s is the previous slot of the same variable times
+        // x^(exp difference), computed by squaring across the lanes.
+        for (size_t s = 0; s < num_slots; ++s)
+        {
+            uint32_t *dst = &powers[s * BLOCK];
+            const uint32_t *x = (const uint32_t *)columns[p.slot_var[s]] + first;
+            int e = p.slot_exp[s];
+            if (s > 0 && p.slot_var[s - 1] == p.slot_var[s])
+            {
+                copy(&powers[(s - 1) * BLOCK], &powers[(s - 1) * BLOCK] + n, dst);
+                e -= p.slot_exp[s - 1];
+            }
+            else
+            {
+                fill(dst, dst + n, 1);
+            }
+            copy(x, x + n, square.begin());
+            for (; e > 0; e >>= 1)
+            {
+                if (e & 1)
+                {
+                    k.mul_into(dst, square.data(), n);
+                }
+                if (e > 1)
+                {
+                    k.mul_into(square.data(), square.data(), n);
+                }
+            }
+        }
+
+        fill(total.begin(), total.begin() + n, 0);
+        fill(step.begin(), step.begin() + n, 1);
+        for (size_t t = 0; t < p.coefficients.size(); ++t)
+        {
+            uint32_t begin = p.term_start[t], end = p.term_start[t + 1];
+            const uint32_t *base = (begin == end) ? step.data() : &powers[p.term_slots[begin] * BLOCK];
+            k.scale(term.data(), base, p.coefficients[t], n);
+            for (uint32_t j = begin + 1; j < end; ++j)
+            {
+                k.mul_into(term.data(), &powers[p.term_slots[j] * BLOCK], n);
+            }
+            k.add_into(total.data(), term.data(), n);
+        }
+        copy(total.begin(), total.begin() + n, (uint32_t *)out + first);
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef __COMPILED_POLY_H__
+#define __COMPILED_POLY_H__
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// A polynomial flattened into its expanded monomials for fast evaluation.
+// Every distinct power x_i^e used by some term is a "power slot"; slots are
+// sorted by variable and then exponent so that each one can be computed
+// from the previous slot of the same variable. Arithmetic is modulo 2^32,
+// which matches the wrap-around of the int evaluator.
+struct CompiledPoly
+{
+    size_t arity = 0;
+
+    std::vector<int> slot_var;
+    std::vector<int> slot_exp;
+
+    // Term t has coefficient coefficients[t] and multiplies the slots
+    // term_slots[term_start[t] .. term_start[t + 1]).
+    std::vector<uint32_t> coefficients;
+    std::vector<uint32_t> term_start;
+    std::vector<uint32_t> term_slots;
+
+    // With at most FIXED_MAX_ARITY arguments and no exponent above
+    // FIXED_MAX_EXPONENT, term t also has its exponents as the row
+    // fixed_exponents[t * arity .. (t + 1) * arity), and eval_compiled uses
+    // a kernel unrolled for that arity. Empty otherwise.
+    std::vector<uint8_t> fixed_exponents;
+    int fixed_max_exponent = 0;
+};
+
+const size_t FIXED_MAX_ARITY = 8;
+const int FIXED_MAX_EXPONENT = 31;
+
+// Fills in the fixed-arity form of p when it qualifies.
+void specialize_fixed_arity(CompiledPoly &p);
+
+// Evaluates p at one argument tuple.
+int eval_compiled(const CompiledPoly &p, const int *args);
+
+// The same through the power slots, whatever the arity. eval_compiled only
+// uses it for the polynomials without a fixed-arity form.
+int eval_compiled_slots(const CompiledPoly &p, const int *args);
+
+// Evaluates p at count argument tuples given as columns: columns[i][j] is
+// argument i of tuple j, and out[j] receives the value of tuple j.
+void eval_compiled_batch(const CompiledPoly &p, const std::vector<const int *> &columns, size_t count, int *out);
+
+// Name of the vector kernels picked for this CPU: "avx2", "sse4.1" or "scalar".
+const char *batch_kernel_name();
+
+#endif
@@ -0,0 +1,477 @@
+#include "dense_poly.h"
+#include <algorithm>
+
+using namespace std;
+
+void dense_trim(DensePoly &p)
+{
+    while (!p.empty() && p.back() == 0)
+    {
+        p.pop_back();
+    }
+}
+
+void dense_add(DensePoly &total, const DensePoly &p, int sign)
+{
+    if (total.size() < p.size())
+    {
+        total.resize(p.size(), 0);
+    }
+    for (size_t i = 0; i < p.size(); ++i)
+    {
+        total[i] += (sign > 0) ? p[i] : -p[i];
+    }
+    dense_trim(total);
+}
+
+// --- Schoolbook and Karatsuba ---
+
+static void schoolbook(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out)
+{
+    // out has na + nb - 1 entries and is accumulated into.
+    for (size_t i = 0; i < na; ++i)
+    {
+        uint32_t ai = a[i];
+        if (ai == 0)
+        {
+            continue;
+        }
+        for (size_t j = 0; j < nb; ++j)
+        {
+            out[i + j] += ai * b[j];
+        }
+    }
+}
+
+// Multiplies two polynomials of n coefficients each into out, which has
+// 2n - 1 entries and is overwritten. Only ring operations are used, so the
+// result is exact modulo 2^32.
+static void karatsuba(const uint32_t *a, const uint32_t *b, size_t n, uint32_t *out)
+{
+    fill(out, out + 2 * n - 1, 0);
+    if (n <= KARATSUBA_THRESHOLD)
+    {
+        schoolbook(a, n, b, n, out);
+        return;
+    }
+
+    size_t lo = n / 2;
+    size_t hi = n - lo; // hi >= lo
+
+    vector<uint32_t> z0(2 * lo - 1), z1(2 * hi - 1), z2(2 * hi - 1);
+    karatsuba(a, b, lo, z0.data());
+    karatsuba(a + lo, b + lo, hi, z2.data());
+
+    vector<uint32_t> a_sum(a + lo, a + n), b_sum(b + lo, b + n);
+    for (size_t i = 0; i < lo; ++i)
+    {
+        a_sum[i] += a[i];
+        b_sum[i] += b[i];
+    }
+    karatsuba(a_sum.data(), b_sum.data(), hi, z1.data());
+
+    for (size_t i = 0; i < z1.size(); ++i)
+    {
+        z1[i] -= z2[i];
+    }
+    for (size_t i = 0; i < z0.size(); ++i)
+    {
+        z1[i] -= z0[i];
+        out[i] += z0[i];
+    }
+    for (size_t i = 0; i < z1.size(); ++i)
+    {
+        out[i + lo] += z1[i];
+    }
+    for (size_t i = 0; i < z2.size(); ++i)
+    {
+        out[i + 2 * lo] += z2[i];
+    }
+}
+
+static DensePoly multiply_karatsuba(const DensePoly &a, const DensePoly &b)
+{
+    // a is the longer operand. It is cut into chunks as long as b so that
+    // every Karatsuba call works on balanced operands.
+    size_t n = b.size();
+    DensePoly result(a.size() + n - 1, 0);
+    vector<uint32_t> chunk(n), partial(2 * n - 1);
+
+    for (size_t offset = 0; offset < a.size(); offset += n)
+    {
+        size_t len = min(n, a.size() - offset);
+        fill(chunk.begin(), chunk.end(), 0);
+        copy(a.begin() + offset, a.begin() + offset + len, chunk.begin());
+        karatsuba(chunk.data(), b.data(), n, partial.data());
+
+        size_t used = min(partial.size(), result.size() - offset);
+        for (size_t i = 0; i < used; ++i)
+        {
+            result[offset + i] += partial[i];
+        }
+    }
+    return result;
+}
+
+// --- Number-theoretic transform ---
+
+// Each prime is c * 2^k + 1 with primitive root 3.
+static const uint32_t NTT_P0 = 998244353;
+static const uint32_t NTT_P1 = 167772161;
+static const uint32_t NTT_P2 = 469762049;
+
+// NTT_P0 = 119 * 2^23 + 1 has no root of unity of a larger power-of-two
+// order, so no transform may be longer.
+static const size_t NTT_MAX_LENGTH = (size_t)1 << 23;
+
+static uint32_t pow_mod(uint64_t base, uint64_t exp, uint32_t mod)
+{
+    uint64_t result = 1;
+    base %= mod;
+    while (exp > 0)
+    {
+        if (exp & 1)
+        {
+            result = result * base % mod;
+        }
+        base = base * base % mod;
+        exp >>= 1;
+    }
+    return (uint32_t)result;
+}
+
+// The modulus is a template parameter so that every % compiles to a
+// multiply-and-shift instead of a division.
+template <uint32_t MOD>
+static void ntt(vector<uint32_t> &a, bool invert)
+{
+    size_t n = a.size();
+    for (size_t i = 1, j = 0; i < n; ++i)
+    {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+        {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j)
+        {
+            swap(a[i], a[j]);
+        }
+    }
+
+    vector<uint32_t> roots(n / 2);
+    for (size_t len = 2; len <= n; len <<= 1)
+    {
+        uint64_t root = pow_mod(3, (MOD - 1) / len, MOD);
+        if (invert)
+        {
+            root = pow_mod(root, MOD - 2, MOD);
+        }
+        size_t half = len / 2;
+        roots[0] = 1;
+        for (size_t j = 1; j < half; ++j)
+        {
+            roots[j] = (uint32_t)(roots[j - 1] * root % MOD);
+        }
+        for (size_t i = 0; i < n; i += len)
+        {
+            uint32_t *lo = &a[i];
+            uint32_t *hi = &a[i + half];
+            for (size_t j = 0; j < half; ++j)
+            {
+                uint32_t u = lo[j];
+                uint32_t v = (uint32_t)((uint64_t)hi[j] * roots[j] % MOD);
+                lo[j] = (u + v >= MOD) ? u + v - MOD : u + v;
+                hi[j] = (u >= v) ? u - v : u + MOD - v;
+            }
+        }
+    }
+
+    if (invert)
+    {
+        uint64_t n_inv = pow_mod(n, MOD - 2, MOD);
+        for (uint32_t &x : a)
+        {
+            x = (uint32_t)(x * n_inv % MOD);
+        }
+    }
+}
+
+template <uint32_t MOD>
+static vector<uint32_t> ntt_convolve(const DensePoly &a, const DensePoly &b, size_t n)
+{
+    vector<uint32_t> fa(n, 0), fb(n, 0);
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+        fa[i] = a[i] % MOD;
+    }
+    for (size_t i = 0; i < b.size(); ++i)
+    {
+        fb[i] = b[i] % MOD;
+    }
+    ntt<MOD>(fa, false);
+    ntt<MOD>(fb, false);
+    for (size_t i = 0; i < n; ++i)
+    {
+        fa[i] = (uint32_t)((uint64_t)fa[i] * fb[i] % MOD);
+    }
+    ntt<MOD>(fa, true);
+    return fa;
+}
+
+static DensePoly multiply_ntt(const DensePoly &a, const DensePoly &b)
+{
+    // The exact convolution of two vectors of 32-bit values is below the
+    // product of the three primes, so it is recovered with the CRT (Garner's
+    // form) and then reduced modulo 2^32.
+    size_t result_size = a.size() + b.size() - 1;
+    size_t n = 1;
+    while (n < result_size)
+    {
+        n <<= 1;
+    }
+    if (n > NTT_MAX_LENGTH)
+    {
+        return multiply_karatsuba(a, b);
+    }
+
+    vector<uint32_t> r[3];
+    r[0] = ntt_convolve<NTT_P0>(a, b, n);
+    r[1] = ntt_convolve<NTT_P1>(a, b, n);
+    r[2] = ntt_convolve<NTT_P2>(a, b, n);
+
+    const uint64_t m0 = NTT_P0, m1 = NTT_P1, m2 = NTT_P2;
+    const uint64_t m0_inv_m1 = pow_mod(m0, m1 - 2, m1);
+    const uint64_t m01_inv_m2 = pow_mod(m0 * m1 % m2, m2 - 2, m2);
+    const uint32_t m0_m1 = (uint32_t)(m0 * m1); // modulo 2^32
+
+    DensePoly result(result_size);
+    for (size_t i = 0; i < result_size; ++i)
+    {
+        uint64_t v0 = r[0][i];
+        uint64_t v1 = (r[1][i] + m1 - v0 % m1) % m1 * m0_inv_m1 % m1;
+        uint64_t x01 = (v0 + m0 * v1) % m2; // value of v0 + m0 * v1 modulo m2
+        uint64_t v2 = (r[2][i] + m2 - x01) % m2 * m01_inv_m2 % m2;
+        result[i] = (uint32_t)v0 + (uint32_t)m0 * (uint32_t)v1 + m0_m1 * (uint32_t)v2;
+    }
+    return result;
+}
+
+DensePoly dense_multiply(const DensePoly &a, const DensePoly &b)
+{
+    if (a.empty() || b.empty())
+    {
+        return DensePoly();
+    }
+    const DensePoly &longer = (a.size() >= b.size()) ? a : b;
+    const DensePoly &shorter = (a.size() >= b.size()) ? b : a;
+
+    DensePoly result;
+    if (shorter.size() <= KARATSUBA_THRESHOLD)
+    {
+        result.assign(longer.size() + shorter.size() - 1, 0);
+        schoolbook(longer.data(), longer.size(), shorter.data(), shorter.size(), result.data());
+    }
+    else if (longer.size() + shorter.size() - 1 >= NTT_THRESHOLD)
+    {
+        result = multiply_ntt(longer, shorter);
+    }
+    else
+    {
+        result = multiply_karatsuba(longer, shorter);
+    }
+    dense_trim(result);
+    return result;
+}
+
+DensePoly dense_product(vector<DensePoly> &factors, size_t lo, size_t hi)
+{
+    if (hi - lo == 1)
+    {
+        return factors[lo];
+    }
+    size_t mid = lo + (hi - lo) / 2;
+    DensePoly left = dense_product(factors, lo, mid);
+    if (left.empty())
+    {
+        return left;
+    }
+    return dense_multiply(left, dense_product(factors, mid, hi));
+}
+
+// --- Division and multipoint evaluation ---
+
+static DensePoly truncated(DensePoly p, size_t n)
+{
+    if (p.size() > n)
+    {
+        p.resize(n);
+    }
+    return p;
+}
+
+// Inverse of f modulo x^n, for f with constant term 1.
+static DensePoly series_inverse(const DensePoly &f, size_t n)
+{
+    DensePoly g(1, 1);
+    size_t len = 1;
+    while (len < n)
+    {
+        len *= 2;
+        // g <- g * (2 - f * g) mod x^len
+        DensePoly t = truncated(dense_multiply(truncated(f, len), g), len);
+        for (uint32_t &c : t)
+        {
+            c = -c;
+        }
+        if (t.empty())
+        {
+            t.push_back(0);
+        }
+        t[0] += 2;
+        g = truncated(dense_multiply(g, t), len);
+    }
+    return truncated(g, n);
+}
+
+DensePoly dense_remainder(const DensePoly &a, const DensePoly &m)
+{
+    size_t d = m.size() - 1; // degree of m; m.back() == 1
+    if (a.size() <= d)
+    {
+        return a;
+    }
+    size_t k = a.size() - d; // number of quotient coefficients
+
+    if (k * d <= NTT_THRESHOLD * 8)
+    {
+        // Long division is cheapest when the quotient or divisor is short.
+        DensePoly r = a;
+        for (size_t i = r.size(); i-- > d;)
+        {
+            uint32_t c = r[i];
+            if (c == 0)
+            {
+                continue;
+            }
+            for (size_t j = 0; j <= d; ++j)
+            {
+                r[i - d + j] -= c * m[j];
+            }
+        }
+        r.resize(d);
+        dense_trim(r);
+        return r;
+    }
+
+    // rev(q) = rev(a) / rev(m) mod x^k, and r = a - q * m.
+    DensePoly rev_a(a.rbegin(), a.rbegin() + k);
+    DensePoly rev_m(m.rbegin(), m.rend());
+    DensePoly rev_q = truncated(dense_multiply(rev_a, series_inverse(rev_m, k)), k);
+    rev_q.resize(k, 0);
+    DensePoly q(rev_q.rbegin(), rev_q.rend());
+    dense_trim(q);
+
+    DensePoly qm = dense_multiply(q, m);
+    DensePoly r(a.begin(), a.begin() + d);
+    for (size_t i = 0; i < d && i < qm.size(); ++i)
+    {
+        r[i] -= qm[i];
+    }
+    dense_trim(r);
+    return r;
+}
+
+static void horner_many(const DensePoly &p, const uint32_t *x, uint32_t *out, size_t count)
+{
+    // The inner loop runs across points, so it vectorizes.
+    for (size_t j = 0; j < count; ++j)
+    {
+        out[j] = 0;
+    }
+    for (size_t i = p.size(); i-- > 0;)
+    {
+        uint32_t c = p[i];
+        for (size_t j = 0; j < count; ++j)
+        {
+            out[j] = out[j] * x[j] + c;
+        }
+    }
+}
+
+// Subproduct-tree evaluation of p at count points, written to values.
+static void evaluate_block(const DensePoly &p, const uint32_t *points, size_t count, uint32_t *values)
+{
+    // Subproduct tree: level 0 holds (x - a_i), and each node of level k + 1
+    // is the product of two nodes of level k, so node j of level k covers
+    // points [j * 2^k, (j + 1) * 2^k).
+    vector<vector<DensePoly>> levels(1);
+    for (size_t i = 0; i < count; ++i)
+    {
+        levels[0].push_back(DensePoly{(uint32_t)-points[i], 1});
+    }
+    while (levels.back().size() > 1)
+    {
+        const vector<DensePoly> &below = levels.back();
+        vector<DensePoly> above;
+        for (size_t j = 0; j < below.size(); j += 2)
+        {
+            above.push_back(j + 1 < below.size() ? dense_multiply(below[j], below[j + 1]) : below[j]);
+        }
+        levels.push_back(above);
+    }
+
+    // Reduce p down the tree. Below blocks of 2^6 points Horner's rule on the
+    // remainder is faster than descending further.
+    size_t base = min<size_t>(6, levels.size() - 1);
+    vector<DensePoly> remainders(1, dense_remainder(p, levels.back()[0]));
+    for (size_t k = levels.size() - 1; k-- > base;)
+    {
+        vector<DensePoly> next(levels[k].size());
+        for (size_t j = 0; j < levels[k].size(); ++j)
+        {
+            next[j] = dense_remainder(remainders[j / 2], levels[k][j]);
+        }
+        remainders.swap(next);
+    }
+
+    size_t block = (size_t)1 << base;
+    for (size_t j = 0; j < remainders.size(); ++j)
+    {
+        size_t first = j * block;
+        horner_many(remainders[j], points + first, values + first, min(block, count - first));
+    }
+}
+
+vector<uint32_t> dense_evaluate(const DensePoly &p, const vector<uint32_t> &points)
+{
+    vector<uint32_t> values(points.size());
+    if (points.size() < MULTIPOINT_MIN_POINTS || p.size() < MULTIPOINT_MIN_DEGREE)
+    {
+        horner_many(p, points.data(), values.data(), points.size());
+        return values;
+    }
+
+    // A tree node whose degree is above deg p leaves p unchanged, so the
+    // points are taken in blocks of the largest power of two up to p.size(),
+    // each with a tree of its own. A short last block uses Horner's rule.
+    size_t block = 1;
+    while (block * 2 <= p.size())
+    {
+        block *= 2;
+    }
+    for (size_t first = 0; first < points.size(); first += block)
+    {
+        size_t count = min(block, points.size() - first);
+        if (count < MULTIPOINT_MIN_POINTS)
+        {
+            horner_many(p, points.data() + first, values.data() + first, count);
+        }
+        else
+        {
+            evaluate_block(p, points.data() + first, count, values.data() + first);
+        }
+    }
+    return values;
+}
@@ -0,0 +1,44 @@
+#ifndef __DENSE_POLY_H__
+#define __DENSE_POLY_H__
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Dense univariate polynomial: entry i is the coefficient of x^i.
+// Coefficients are kept modulo 2^32, which is exactly the wrap-around of
+// the int coefficients used by the sparse representation, so converting
+// back with a cast gives the same values. Trailing zero coefficients are
+// trimmed, so the zero polynomial is the empty vector.
+typedef std::vector<uint32_t> DensePoly;
+
+// Product sizes (in coefficients) at which multiplication switches from
+// schoolbook to Karatsuba and from Karatsuba to NTT.
+const size_t KARATSUBA_THRESHOLD = 32;
+const size_t NTT_THRESHOLD = 1024;
+
+// Largest degree the NTT path supports exactly: three 30-bit primes give
+// room for 2^22 products of 32-bit coefficients.
+const size_t DENSE_MAX_DEGREE = 1 << 20;
+
+void dense_trim(DensePoly &p);
+void dense_add(DensePoly &total, const DensePoly &p, int sign);
+DensePoly dense_multiply(const DensePoly &a, const DensePoly &b);
+
+// Multiplies factors[lo, hi) in a balanced tree.
+DensePoly dense_product(std::vector<DensePoly> &factors, size_t lo, size_t hi);
+
+// Remainder of a divided by the monic polynomial m. Large divisions use a
+// Newton-iteration inverse, so they cost a constant number of products.
+DensePoly dense_remainder(const DensePoly &a, const DensePoly &m);
+
+// Point counts and degrees from which dense_evaluate switches from Horner's
+// rule to subproduct-tree multipoint evaluation. Below them the vectorized
+// Horner loop is faster in practice.
+const size_t MULTIPOINT_MIN_POINTS = 32768;
+const size_t MULTIPOINT_MIN_DEGREE = 32768;
+
+// Values of p at every point.
+std::vector<uint32_t> dense_evaluate(const DensePoly &p, const std::vector<uint32_t> &points);
+
+#endif
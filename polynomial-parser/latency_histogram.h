@@ -0,0 +1,88 @@
+#ifndef __LATENCY_HISTOGRAM_H__
+#define __LATENCY_HISTOGRAM_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Lock-free histogram of request latencies in nanoseconds. Every power of
+// two is split into eight buckets, so a percentile read back from it is
+// within 12.5% of the true value while the memory stays fixed no matter
+// how many requests are recorded.
+class LatencyHistogram
+{
+public:
+    LatencyHistogram()
+    {
+        for (auto &bucket : buckets)
+        {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void record(uint64_t ns)
+    {
+        buckets[bucket_of(ns)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t count() const
+    {
+        uint64_t total = 0;
+        for (const auto &bucket : buckets)
+        {
+            total += bucket.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    // Upper bound of the bucket holding the q-th quantile, 0 <= q <= 1.
+    uint64_t percentile(double q) const
+    {
+        uint64_t total = count();
+        uint64_t target = (uint64_t)(q * total);
+        if (target == 0)
+        {
+            target = 1;
+        }
+        uint64_t seen = 0;
+        for (size_t b = 0; b < NUM_BUCKETS; ++b)
+        {
+            seen += buckets[b].load(std::memory_order_relaxed);
+            if (seen >= target)
+            {
+                return bucket_limit(b);
+            }
+        }
+        return 0;
+    }
+
+private:
+    static const size_t SUB_BUCKETS = 8;
+    static const size_t NUM_BUCKETS = 62 * SUB_BUCKETS;
+    std::atomic<uint64_t> buckets[NUM_BUCKETS];
+
+    // Values below 8 get a bucket each; above that the bucket is the
+    // position of the top bit plus the three bits below it.
+    static size_t bucket_of(uint64_t ns)
+    {
+        if (ns < SUB_BUCKETS)
+        {
+            return ns;
+        }
+        int log = 63 - __builtin_clzll(ns);
+        return (log - 2) * SUB_BUCKETS + ((ns >> (log - 3)) & (SUB_BUCKETS - 1));
+    }
+
+    static uint64_t bucket_limit(size_t b)
+    {
+        if (b < SUB_BUCKETS)
+        {
+            return b;
+        }
+        int log = b / SUB_BUCKETS + 2;
+        uint64_t width = 1ULL << (log - 3);
+        return (SUB_BUCKETS + b % SUB_BUCKETS) * width + width - 1;
+    }
+};
+
+#endif
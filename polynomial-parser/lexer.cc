@@ -8,6 +8,9 @@
 #include <vector>
 #include <string>
 #include <cctype>
+#include <sstream>
+#include <algorithm>
+#include <iterator>
 
 #include "lexer.h"
 #include "inputbuf.h"
@@ -32,6 +35,16 @@ void Token::Print()
 // The constructor function will get all token in the input and stores them in an
 // internal vector. This faciliates the implementation of peek()
 LexicalAnalyzer::LexicalAnalyzer()
+{
+    ReadTokens();
+}
+
+LexicalAnalyzer::LexicalAnalyzer(istream& source) : input(source)
+{
+    ReadTokens();
+}
+
+void LexicalAnalyzer::ReadTokens()
 {
     this->line_no = 1;
     tmp.lexeme = "";
@@ -156,6 +169,8 @@ Token LexicalAnalyzer::ScanIdOrKeyword()
 // lexer object is instantiated
 Token LexicalAnalyzer::GetToken()
 {
+    WaitForToken(index);
+
     Token token;
     if (index == tokenList.size()){       // return end of file if
         token.lexeme = "";                // index is too large
@@ -180,6 +195,8 @@ Token LexicalAnalyzer::peek(int howFar)
     } 
 
     int peekIndex = index + howFar - 1;
+    WaitForToken(peekIndex);
+
     if (peekIndex > (tokenList.size()-1)) { // if peeking too far
         Token token;                        // return END_OF_FILE
         token.lexeme = "";
@@ -227,3 +244,79 @@ Token LexicalAnalyzer::GetTokenMain()
             return tmp;
     }
 }
+
+// The parser thread takes the tokens that have arrived a whole chunk at a
+// time, so it reads tokenList without a lock and waits only when it has
+// used up every token it was given.
+void LexicalAnalyzer::WaitForToken(int position)
+{
+    if (!streaming || all_tokens || position < (int) tokenList.size())
+        return;
+    std::unique_lock<std::mutex> lock(tokens_mutex);
+    while (true) {
+        tokenList.insert(tokenList.end(), make_move_iterator(incoming.begin()),
+                         make_move_iterator(incoming.end()));
+        incoming.clear();
+        if (finished)
+            all_tokens = true;
+        if (all_tokens || position < (int) tokenList.size())
+            return;
+        tokens_arrived.wait(lock);
+    }
+}
+
+void LexicalAnalyzer::Push(const string& bytes)
+{
+    if (!streaming) {
+        // Lexing the empty stream given to the constructor may have
+        // counted a line that is not there.
+        line_no = 1;
+        streaming = true;
+    }
+    pending += bytes;
+
+    // Only a run of letters and digits can continue into the next chunk;
+    // everything before it tokenizes as it would in one piece.
+    size_t complete = pending.size();
+    while (complete > 0 && isalnum((unsigned char) pending[complete - 1]))
+        complete--;
+    LexPending(complete);
+}
+
+void LexicalAnalyzer::Finish()
+{
+    if (!streaming) {
+        line_no = 1;
+        streaming = true;
+    }
+    LexPending(pending.size());
+    std::lock_guard<std::mutex> lock(tokens_mutex);
+    finished = true;
+    tokens_arrived.notify_all();
+}
+
+void LexicalAnalyzer::LexPending(size_t size)
+{
+    if (size == 0)
+        return;
+    istringstream chunk(pending.substr(0, size));
+    int chunk_line = line_no;
+    int newlines = count(pending.begin(), pending.begin() + size, '\n');
+    pending.erase(0, size);
+
+    vector<Token> tokens;
+    input = InputBuffer(chunk);
+    Token token = GetTokenMain();
+    while (token.token_type != END_OF_FILE) {
+        tokens.push_back(token);
+        token = GetTokenMain();
+    }
+    // The end of the chunk is not the end of the input, so whatever the
+    // scan did to line_no there is replaced by the real count.
+    line_no = chunk_line + newlines;
+
+    std::lock_guard<std::mutex> lock(tokens_mutex);
+    incoming.insert(incoming.end(), make_move_iterator(tokens.begin()),
+                    make_move_iterator(tokens.end()));
+    tokens_arrived.notify_all();
+}
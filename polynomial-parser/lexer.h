@@ -8,6 +8,9 @@
 
 #include <vector>
 #include <string>
+#include <istream>
+#include <mutex>
+#include <condition_variable>
 
 #include "inputbuf.h"
 
@@ -34,15 +37,32 @@ class LexicalAnalyzer {
     Token GetToken();
     Token peek(int);
     LexicalAnalyzer();
+    explicit LexicalAnalyzer(std::istream&);
+
+    // Push mode: the input arrives in chunks after construction, and is
+    // tokenized as it comes. GetToken() and peek() then wait for tokens
+    // that have not arrived yet, so the parser can run on another thread.
+    void Push(const std::string&);
+    void Finish();
 
   private:
     std::vector<Token> tokenList;
+    bool streaming = false;      // Set by the first Push()
+    std::string pending;         // Received but not yet tokenized
+    std::mutex tokens_mutex;     // Guards incoming and finished
+    std::condition_variable tokens_arrived;
+    std::vector<Token> incoming; // Tokenized, not yet moved to tokenList
+    bool finished = false;       // No more chunks will come
+    bool all_tokens = false;     // The parser has seen finished; tokenList is complete
+    void LexPending(size_t);
+    void WaitForToken(int);
     Token GetTokenMain();
     int line_no;
     int index;
     Token tmp;
     InputBuffer input;
 
+    void ReadTokens();
     bool SkipSpace();
     bool IsKeyword(std::string);
     TokenType FindKeywordIndex(std::string);
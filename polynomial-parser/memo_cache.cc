@@ -0,0 +1,124 @@
+#include "memo_cache.h"
+#include <utility>
+
+using namespace std;
+
+MemoCache::MemoCache(size_t max_entries) : max_entries(max_entries > 0 ? max_entries : 1)
+{
+    // Keep the load factor at or below one half so probe runs stay short.
+    size_t capacity = 2;
+    while (capacity < 2 * this->max_entries)
+    {
+        capacity <<= 1;
+    }
+    slots.resize(capacity);
+    mask = capacity - 1;
+}
+
+uint64_t MemoCache::hash_key(int poly_index, const vector<int> &args)
+{
+    // FNV-1a over the index and argument words, then a final mix so the low
+    // bits used for the slot index depend on every input bit.
+    uint64_t h = 1469598103934665603ULL;
+    h = (h ^ (uint32_t)poly_index) * 1099511628211ULL;
+    for (int a : args)
+    {
+        h = (h ^ (uint32_t)a) * 1099511628211ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+size_t MemoCache::find(uint64_t hash, int poly_index, const vector<int> &args) const
+{
+    for (size_t i = hash & mask;; i = (i + 1) & mask)
+    {
+        const Slot &slot = slots[i];
+        if (!slot.used)
+        {
+            return i;
+        }
+        if (slot.hash == hash && slot.poly_index == poly_index && slot.args == args)
+        {
+            return i;
+        }
+    }
+}
+
+bool MemoCache::lookup(int poly_index, const vector<int> &args, int &value)
+{
+    lock_guard<mutex> lock(table_mutex);
+    Slot &slot = slots[find(hash_key(poly_index, args), poly_index, args)];
+    if (!slot.used)
+    {
+        miss_count++;
+        return false;
+    }
+    slot.referenced = true;
+    value = slot.value;
+    hit_count++;
+    return true;
+}
+
+void MemoCache::insert(int poly_index, const vector<int> &args, int value)
+{
+    uint64_t hash = hash_key(poly_index, args);
+    lock_guard<mutex> lock(table_mutex);
+    size_t index = find(hash, poly_index, args);
+    if (slots[index].used)
+    {
+        slots[index].value = value;
+        return;
+    }
+    if (entry_count >= max_entries)
+    {
+        evict_one();
+        index = find(hash, poly_index, args); // the eviction may have moved entries
+    }
+    Slot &slot = slots[index];
+    slot.used = true;
+    slot.referenced = false;
+    slot.hash = hash;
+    slot.poly_index = poly_index;
+    slot.value = value;
+    slot.args = args;
+    entry_count++;
+}
+
+void MemoCache::evict_one()
+{
+    while (true)
+    {
+        Slot &slot = slots[hand];
+        if (slot.used && !slot.referenced)
+        {
+            erase_at(hand);
+            eviction_count++;
+            return;
+        }
+        slot.referenced = false;
+        hand = (hand + 1) & mask;
+    }
+}
+
+void MemoCache::erase_at(size_t index)
+{
+    // Backward-shift deletion: pull later members of the probe run into the
+    // hole so lookups never need tombstones.
+    slots[index].used = false;
+    entry_count--;
+    size_t hole = index;
+    for (size_t i = (index + 1) & mask; slots[i].used; i = (i + 1) & mask)
+    {
+        size_t home = slots[i].hash & mask;
+        // Move the entry if its home slot is not within (hole, i].
+        bool home_after_hole = (i >= hole) ? (home > hole && home <= i) : (home > hole || home <= i);
+        if (!home_after_hole)
+        {
+            swap(slots[hole], slots[i]);
+            hole = i;
+        }
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef __MEMO_CACHE_H__
+#define __MEMO_CACHE_H__
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <mutex>
+
+// Bounded cache of polynomial call results keyed on (polynomial index,
+// argument tuple). Entries live in an open-addressing table with linear
+// probing; when the table is full, a clock hand evicts the first entry
+// that has not been hit since the hand last passed it. Lookups and
+// inserts may come from several threads at once.
+class MemoCache
+{
+public:
+    explicit MemoCache(size_t max_entries);
+
+    bool lookup(int poly_index, const std::vector<int> &args, int &value);
+    void insert(int poly_index, const std::vector<int> &args, int value);
+
+    size_t hits() const { return hit_count; }
+    size_t misses() const { return miss_count; }
+    size_t evictions() const { return eviction_count; }
+    size_t size() const { return entry_count; }
+
+private:
+    struct Slot
+    {
+        bool used = false;
+        bool referenced = false;
+        uint64_t hash = 0;
+        int poly_index = 0;
+        int value = 0;
+        std::vector<int> args;
+    };
+
+    std::mutex table_mutex;
+    std::vector<Slot> slots;
+    size_t mask;
+    size_t max_entries;
+    size_t entry_count = 0;
+    size_t hand = 0;
+    size_t hit_count = 0;
+    size_t miss_count = 0;
+    size_t eviction_count = 0;
+
+    static uint64_t hash_key(int poly_index, const std::vector<int> &args);
+    size_t find(uint64_t hash, int poly_index, const std::vector<int> &args) const;
+    void evict_one();
+    void erase_at(size_t index);
+};
+
+#endif
@@ -0,0 +1,251 @@
+#include "native_module.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <vector>
+#include <initializer_list>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <pwd.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+static const char *const NATIVE_COMPILE_FLAGS[] = {"-std=c++11", "-O2", "-fPIC", "-shared"};
+
+static void remove_all(initializer_list<string> paths)
+{
+    for (const string &path : paths)
+    {
+        if (!path.empty())
+        {
+            remove(path.c_str());
+        }
+    }
+}
+
+NativeModule::~NativeModule()
+{
+    close();
+}
+
+string NativeModule::default_dir()
+{
+    const char *cache = getenv("XDG_CACHE_HOME");
+    if (cache && cache[0] == '/')
+    {
+        return string(cache) + "/polynomial-parser";
+    }
+    const char *home = getenv("HOME");
+    if (!home || !*home)
+    {
+        struct passwd *pw = getpwuid(geteuid());
+        home = pw ? pw->pw_dir : nullptr;
+    }
+    return home && *home ? string(home) + "/.cache/polynomial-parser" : "";
+}
+
+// Loading an object runs its code, so the cache only trusts files and
+// directories that belong to this user and no one else can write to.
+static bool is_private(const struct stat &st)
+{
+    return st.st_uid == geteuid() && (st.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+}
+
+bool NativeModule::prepare_dir(const string &dir, string &error)
+{
+    if (dir.empty())
+    {
+        error = "no cache directory, give one with --native=DIR\n";
+        return false;
+    }
+    // Missing directories on the way are created private to the user.
+    for (size_t slash = dir.find('/', 1);; slash = dir.find('/', slash + 1))
+    {
+        string prefix = dir.substr(0, slash);
+        if (mkdir(prefix.c_str(), 0700) != 0 && errno != EEXIST)
+        {
+            error = "cannot create " + prefix + ": " + strerror(errno) + "\n";
+            return false;
+        }
+        if (slash == string::npos)
+        {
+            break;
+        }
+    }
+    struct stat st;
+    if (stat(dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode))
+    {
+        error = dir + " is not a directory\n";
+        return false;
+    }
+    if (!is_private(st))
+    {
+        error = "refusing " + dir + ": it must belong to the user and not be writable by others\n";
+        return false;
+    }
+    return true;
+}
+
+string NativeModule::path_for(const string &dir, uint64_t source_hash)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.so", (unsigned long long)source_hash);
+    return dir + "/" + name;
+}
+
+// Creates an empty file named stem.XXXXXX suffix, with the X's chosen to
+// make the name unique, and returns the name, or "" if it cannot. Every
+// build gets its own files, so concurrent builds of the same source, in
+// this process or another, never write to each other's.
+static string make_temp(const string &stem, const string &suffix)
+{
+    string name = stem + ".XXXXXX" + suffix;
+    vector<char> buffer(name.begin(), name.end());
+    buffer.push_back('\0');
+    int fd = mkstemps(buffer.data(), (int)suffix.size());
+    if (fd < 0)
+    {
+        return "";
+    }
+    ::close(fd);
+    return buffer.data();
+}
+
+static bool write_file(const string &path, const string &contents)
+{
+    FILE *f = fopen(path.c_str(), "wb");
+    if (!f)
+    {
+        return false;
+    }
+    bool written = fwrite(contents.data(), 1, contents.size(), f) == contents.size();
+    return (fclose(f) == 0) && written;
+}
+
+// Runs args without a shell, with both output streams in log_path, and
+// returns whether the command succeeded.
+static bool run_command(const vector<string> &args, const string &log_path)
+{
+    vector<char *> argv;
+    for (const string &arg : args)
+    {
+        argv.push_back(const_cast<char *>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    int log_fd = ::open(log_path.c_str(), O_WRONLY | O_TRUNC | O_CLOEXEC);
+    if (log_fd < 0)
+    {
+        return false;
+    }
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        dup2(log_fd, STDOUT_FILENO);
+        dup2(log_fd, STDERR_FILENO);
+        execvp(argv[0], argv.data());
+        _exit(127);
+    }
+    ::close(log_fd);
+    if (pid < 0)
+    {
+        return false;
+    }
+    int status;
+    while (waitpid(pid, &status, 0) < 0)
+    {
+        if (errno != EINTR)
+        {
+            return false;
+        }
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+bool NativeModule::compile(const string &source, const string &object_path, string &built_path, string &log)
+{
+    string stem = object_path.substr(0, object_path.size() - 3);
+    string source_path = make_temp(stem, ".cc");
+    string log_path = make_temp(stem, ".log");
+    built_path = make_temp(stem, ".so");
+    if (source_path.empty() || log_path.empty() || built_path.empty() || !write_file(source_path, source))
+    {
+        log = "cannot write beside " + object_path + "\n";
+        remove_all({source_path, log_path, built_path});
+        return false;
+    }
+
+    // $CXX may carry its own arguments, as in "ccache g++".
+    const char *compiler = getenv("CXX");
+    istringstream words(compiler && *compiler ? compiler : "c++");
+    vector<string> args;
+    for (string word; words >> word;)
+    {
+        args.push_back(word);
+    }
+    if (args.empty())
+    {
+        args.push_back("c++");
+    }
+    args.insert(args.end(), begin(NATIVE_COMPILE_FLAGS), end(NATIVE_COMPILE_FLAGS));
+    args.insert(args.end(), {"-o", built_path, source_path});
+    bool compiled = run_command(args, log_path);
+
+    ifstream log_file(log_path);
+    log.assign(istreambuf_iterator<char>(log_file), istreambuf_iterator<char>());
+    remove(log_path.c_str());
+    // The source is kept beside the object for inspection.
+    if (rename(source_path.c_str(), (stem + ".cc").c_str()) != 0)
+    {
+        remove(source_path.c_str());
+    }
+    // The linker creates the object under the umask; it must be private
+    // for open to accept it.
+    if (!compiled || chmod(built_path.c_str(), 0700) != 0)
+    {
+        remove(built_path.c_str());
+        if (log.empty())
+        {
+            for (const string &arg : args)
+            {
+                log += arg + " ";
+            }
+            log += "failed\n";
+        }
+        return false;
+    }
+    return true;
+}
+
+bool NativeModule::open(const string &path)
+{
+    close();
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode) || !is_private(st))
+    {
+        return false;
+    }
+    handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    return handle != nullptr;
+}
+
+void NativeModule::close()
+{
+    if (handle)
+    {
+        dlclose(handle);
+        handle = nullptr;
+    }
+}
+
+void *NativeModule::symbol(const char *name) const
+{
+    return handle ? dlsym(handle, name) : nullptr;
+}
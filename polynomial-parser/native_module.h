@@ -0,0 +1,57 @@
+#ifndef __NATIVE_MODULE_H__
+#define __NATIVE_MODULE_H__
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// Entry points of a generated module. A polynomial function takes its
+// arguments by position; execute runs the EXECUTE section on the given
+// INPUTS over mem, which must be zeroed and hold every memory location,
+// and returns how many values it wrote to outputs.
+typedef int32_t (*NativePoly)(const int32_t *args);
+typedef size_t (*NativeExecute)(const int32_t *inputs, size_t num_inputs, uint32_t *mem, int32_t *outputs);
+
+// A shared object built from generated C++ source with the system compiler
+// ($CXX, or c++) and loaded with dlopen. Objects are named after a hash of
+// their source, so a directory of them serves as a cache. The cache must be
+// private to the user, as anyone who can write to it can run code here.
+class NativeModule
+{
+public:
+    NativeModule() = default;
+    ~NativeModule();
+    NativeModule(const NativeModule &) = delete;
+    NativeModule &operator=(const NativeModule &) = delete;
+
+    // $XDG_CACHE_HOME/polynomial-parser, or ~/.cache/polynomial-parser.
+    // Empty if the user has no home directory.
+    static std::string default_dir();
+
+    // Creates dir and any missing parents with mode 0700 and checks that
+    // it belongs to the user and that no one else can write to it. On
+    // failure, error says why.
+    static bool prepare_dir(const std::string &dir, std::string &error);
+
+    // Path of the object for a source hash; the source is kept beside it
+    // with the extension .cc.
+    static std::string path_for(const std::string &dir, uint64_t source_hash);
+
+    // Compiles source into a shared object with a name of its own beside
+    // object_path, returned in built_path, for the caller to check and
+    // rename into place. On failure, log holds what the compiler printed.
+    static bool compile(const std::string &source, const std::string &object_path, std::string &built_path,
+                        std::string &log);
+
+    // Fails on an object that does not belong to the user or that others
+    // can write to.
+    bool open(const std::string &path);
+    void close();
+    bool is_open() const { return handle != nullptr; }
+    void *symbol(const char *name) const; // Null if missing
+
+private:
+    void *handle = nullptr;
+};
+
+#endif
@@ -0,0 +1,181 @@
+#include "numeric.h"
+#include <algorithm>
+
+using namespace std;
+
+// --- BigInt magnitude arithmetic ---
+
+static int compare_magnitudes(const vector<uint32_t> &a, const vector<uint32_t> &b)
+{
+    if (a.size() != b.size())
+    {
+        return a.size() < b.size() ? -1 : 1;
+    }
+    for (size_t i = a.size(); i-- > 0;)
+    {
+        if (a[i] != b[i])
+        {
+            return a[i] < b[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+static vector<uint32_t> add_magnitudes(const vector<uint32_t> &a, const vector<uint32_t> &b)
+{
+    const vector<uint32_t> &longer = a.size() >= b.size() ? a : b;
+    const vector<uint32_t> &shorter = a.size() >= b.size() ? b : a;
+    vector<uint32_t> sum(longer.size() + 1);
+    uint64_t carry = 0;
+    for (size_t i = 0; i < longer.size(); ++i)
+    {
+        carry += (uint64_t)longer[i] + (i < shorter.size() ? shorter[i] : 0);
+        sum[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+    sum[longer.size()] = (uint32_t)carry;
+    return sum;
+}
+
+// a - b for |a| >= |b|.
+static vector<uint32_t> subtract_magnitudes(const vector<uint32_t> &a, const vector<uint32_t> &b)
+{
+    vector<uint32_t> difference(a.size());
+    int64_t borrow = 0;
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+        int64_t d = (int64_t)a[i] - (i < b.size() ? b[i] : 0) - borrow;
+        borrow = d < 0;
+        difference[i] = (uint32_t)(d + (borrow << 32));
+    }
+    return difference;
+}
+
+static vector<uint32_t> multiply_magnitudes(const vector<uint32_t> &a, const vector<uint32_t> &b)
+{
+    vector<uint32_t> product(a.size() + b.size());
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+        uint64_t carry = 0;
+        for (size_t j = 0; j < b.size(); ++j)
+        {
+            carry += (uint64_t)a[i] * b[j] + product[i + j];
+            product[i + j] = (uint32_t)carry;
+            carry >>= 32;
+        }
+        product[i + b.size()] = (uint32_t)carry;
+    }
+    return product;
+}
+
+void BigInt::magnitude_of(const BigInt &x, vector<uint32_t> &m, bool &negative)
+{
+    if (!x.mag.empty())
+    {
+        m = x.mag;
+        negative = x.neg;
+        return;
+    }
+    negative = x.small < 0;
+    uint64_t u = negative ? 0 - (uint64_t)x.small : (uint64_t)x.small;
+    m.clear();
+    if (u != 0)
+    {
+        m.push_back((uint32_t)u);
+        if (u >> 32)
+        {
+            m.push_back((uint32_t)(u >> 32));
+        }
+    }
+}
+
+BigInt BigInt::from_magnitude(vector<uint32_t> m, bool negative)
+{
+    while (!m.empty() && m.back() == 0)
+    {
+        m.pop_back();
+    }
+    if (m.size() <= 2)
+    {
+        uint64_t u = m.empty() ? 0 : m[0] | (m.size() > 1 ? (uint64_t)m[1] << 32 : 0);
+        if (!negative && u <= (uint64_t)INT64_MAX)
+        {
+            return BigInt((long long)u);
+        }
+        if (negative && u <= (uint64_t)INT64_MAX + 1)
+        {
+            return BigInt((long long)(0 - u));
+        }
+    }
+    BigInt result;
+    result.mag = move(m);
+    result.neg = negative;
+    return result;
+}
+
+BigInt BigInt::add_slow(const BigInt &a, const BigInt &b, bool subtract)
+{
+    vector<uint32_t> ma, mb;
+    bool na, nb;
+    magnitude_of(a, ma, na);
+    magnitude_of(b, mb, nb);
+    if (subtract)
+    {
+        nb = !nb;
+    }
+    if (na == nb)
+    {
+        return from_magnitude(add_magnitudes(ma, mb), na);
+    }
+    if (compare_magnitudes(ma, mb) >= 0)
+    {
+        return from_magnitude(subtract_magnitudes(ma, mb), na);
+    }
+    return from_magnitude(subtract_magnitudes(mb, ma), nb);
+}
+
+BigInt BigInt::mul_slow(const BigInt &a, const BigInt &b)
+{
+    vector<uint32_t> ma, mb;
+    bool na, nb;
+    magnitude_of(a, ma, na);
+    magnitude_of(b, mb, nb);
+    return from_magnitude(multiply_magnitudes(ma, mb), na != nb);
+}
+
+string BigInt::abs_string() const
+{
+    vector<uint32_t> m;
+    bool negative;
+    magnitude_of(*this, m, negative);
+    if (m.empty())
+    {
+        return "0";
+    }
+
+    // Peel off nine decimal digits at a time, least significant first.
+    vector<uint32_t> chunks;
+    while (!m.empty())
+    {
+        uint64_t remainder = 0;
+        for (size_t i = m.size(); i-- > 0;)
+        {
+            uint64_t current = (remainder << 32) | m[i];
+            m[i] = (uint32_t)(current / 1000000000);
+            remainder = current % 1000000000;
+        }
+        chunks.push_back((uint32_t)remainder);
+        while (!m.empty() && m.back() == 0)
+        {
+            m.pop_back();
+        }
+    }
+
+    string digits = to_string(chunks.back());
+    for (size_t i = chunks.size() - 1; i-- > 0;)
+    {
+        string chunk = to_string(chunks[i]);
+        digits += string(9 - chunk.size(), '0') + chunk;
+    }
+    return digits;
+}
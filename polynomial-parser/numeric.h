@@ -0,0 +1,263 @@
+#ifndef __NUMERIC_H__
+#define __NUMERIC_H__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Number types the evaluator and the expansion engine can be instantiated
+// with. Each one converts from int and provides +, -, *, is_zero(),
+// is_negative(), str() and abs_string(). The default mode keeps the plain
+// int code, whose arithmetic wraps modulo 2^32.
+enum NumericMode
+{
+    NUMERIC_INT32,
+    NUMERIC_CHECKED64,
+    NUMERIC_BIGINT,
+    NUMERIC_MODULAR
+};
+
+// Thrown when a checked result does not fit its type.
+struct NumericOverflow
+{
+};
+
+// 64-bit integers that throw NumericOverflow instead of wrapping.
+class Checked64
+{
+public:
+    Checked64(long long v = 0) : v(v) {}
+
+    friend Checked64 operator+(Checked64 a, Checked64 b)
+    {
+        long long r;
+        if (__builtin_add_overflow(a.v, b.v, &r))
+        {
+            throw NumericOverflow{};
+        }
+        return r;
+    }
+    friend Checked64 operator-(Checked64 a, Checked64 b)
+    {
+        long long r;
+        if (__builtin_sub_overflow(a.v, b.v, &r))
+        {
+            throw NumericOverflow{};
+        }
+        return r;
+    }
+    friend Checked64 operator*(Checked64 a, Checked64 b)
+    {
+        long long r;
+        if (__builtin_mul_overflow(a.v, b.v, &r))
+        {
+            throw NumericOverflow{};
+        }
+        return r;
+    }
+
+    bool is_zero() const { return v == 0; }
+    bool is_negative() const { return v < 0; }
+    std::string str() const { return std::to_string(v); }
+    std::string abs_string() const { return std::to_string(v < 0 ? 0 - (unsigned long long)v : (unsigned long long)v); }
+
+private:
+    long long v;
+};
+
+// Arbitrary-precision integers. Values that fit in a long long are kept
+// inline and combined with the overflow builtins; only results that do not
+// fit move to a heap magnitude.
+class BigInt
+{
+public:
+    BigInt(long long v = 0) : small(v) {}
+
+    friend BigInt operator+(const BigInt &a, const BigInt &b)
+    {
+        long long r;
+        if (a.mag.empty() && b.mag.empty() && !__builtin_add_overflow(a.small, b.small, &r))
+        {
+            return r;
+        }
+        return add_slow(a, b, false);
+    }
+    friend BigInt operator-(const BigInt &a, const BigInt &b)
+    {
+        long long r;
+        if (a.mag.empty() && b.mag.empty() && !__builtin_sub_overflow(a.small, b.small, &r))
+        {
+            return r;
+        }
+        return add_slow(a, b, true);
+    }
+    friend BigInt operator*(const BigInt &a, const BigInt &b)
+    {
+        long long r;
+        if (a.mag.empty() && b.mag.empty() && !__builtin_mul_overflow(a.small, b.small, &r))
+        {
+            return r;
+        }
+        return mul_slow(a, b);
+    }
+
+    bool is_zero() const { return mag.empty() && small == 0; }
+    bool is_negative() const { return mag.empty() ? small < 0 : neg; }
+    std::string str() const { return is_negative() ? "-" + abs_string() : abs_string(); }
+    std::string abs_string() const;
+
+private:
+    // While mag is empty the value is small. Otherwise it is mag (base 2^32,
+    // least significant word first) with the sign neg, and does not fit in
+    // a long long.
+    long long small = 0;
+    bool neg = false;
+    std::vector<uint32_t> mag;
+
+    static void magnitude_of(const BigInt &x, std::vector<uint32_t> &m, bool &negative);
+    static BigInt from_magnitude(std::vector<uint32_t> m, bool negative);
+    static BigInt add_slow(const BigInt &a, const BigInt &b, bool subtract);
+    static BigInt mul_slow(const BigInt &a, const BigInt &b);
+};
+
+// Residues modulo an odd modulus p < 2^63, chosen once with set_modulus()
+// before any value is made. Values are kept in Montgomery form (x * 2^64
+// mod p) so a product needs two multiplications and a shift instead of a
+// 128-bit division. Residues print as their canonical value in [0, p).
+// Every Field tag has a modulus of its own, so the Task 6 fingerprints
+// never touch the one chosen with --modulus.
+template <class Field>
+class MontgomeryInt
+{
+public:
+    MontgomeryInt(long long v = 0) : m(to_montgomery(v)) {}
+
+    static void set_modulus(uint64_t modulus)
+    {
+        p = modulus;
+
+        // Newton's iteration doubles the number of correct low bits of p^-1;
+        // p itself is correct to three bits for any odd p.
+        uint64_t inverse = p;
+        for (int i = 0; i < 5; ++i)
+        {
+            inverse *= 2 - p * inverse;
+        }
+        neg_inverse = 0 - inverse;
+
+        uint64_t r = (0 - p) % p; // 2^64 mod p
+        r_squared = (uint64_t)((unsigned __int128)r * r % p);
+    }
+    static uint64_t modulus() { return p; }
+
+    friend MontgomeryInt operator+(MontgomeryInt a, MontgomeryInt b)
+    {
+        uint64_t r = a.m + b.m;
+        return from_raw(r >= p ? r - p : r);
+    }
+    friend MontgomeryInt operator-(MontgomeryInt a, MontgomeryInt b)
+    {
+        return from_raw(a.m >= b.m ? a.m - b.m : a.m + (p - b.m));
+    }
+    friend MontgomeryInt operator*(MontgomeryInt a, MontgomeryInt b)
+    {
+        return from_raw(reduce((unsigned __int128)a.m * b.m));
+    }
+
+    bool is_zero() const { return m == 0; }
+    bool is_negative() const { return false; }
+    std::string str() const { return std::to_string(reduce(m)); }
+    std::string abs_string() const { return str(); }
+
+private:
+    uint64_t m;
+
+    static inline uint64_t p = 0;
+    static inline uint64_t neg_inverse = 0; // -p^-1 mod 2^64
+    static inline uint64_t r_squared = 0;   // 2^128 mod p
+
+    static MontgomeryInt from_raw(uint64_t m)
+    {
+        MontgomeryInt r;
+        r.m = m;
+        return r;
+    }
+
+    // Montgomery reduction: t * 2^-64 mod p for t < p * 2^64.
+    static uint64_t reduce(unsigned __int128 t)
+    {
+        uint64_t q = (uint64_t)t * neg_inverse;
+        uint64_t r = (uint64_t)((t + (unsigned __int128)q * p) >> 64);
+        return r >= p ? r - p : r;
+    }
+
+    static uint64_t to_montgomery(long long v)
+    {
+        if (p == 0)
+        {
+            return 0;
+        }
+        long long residue = v % (long long)p;
+        if (residue < 0)
+        {
+            residue += p;
+        }
+        return reduce((unsigned __int128)residue * r_squared);
+    }
+};
+
+struct ModulusField;     // --modulus
+struct FingerprintField; // Task 6
+typedef MontgomeryInt<ModulusField> ModInt;
+typedef MontgomeryInt<FingerprintField> FingerprintInt;
+
+// The same interface for the plain int mode, so formatting code can be
+// shared with it.
+inline bool numeric_is_zero(int v) { return v == 0; }
+inline bool numeric_is_negative(int v) { return v < 0; }
+inline std::string numeric_abs_string(int v) { return std::to_string(v < 0 ? -v : v); }
+
+// base^exp wrapping like int arithmetic.
+inline int numeric_power(int base, long long exp)
+{
+    uint32_t result = 1;
+    uint32_t square = (uint32_t)base;
+    for (; exp > 0; exp >>= 1)
+    {
+        if (exp & 1)
+        {
+            result *= square;
+        }
+        square *= square;
+    }
+    return (int)result;
+}
+
+template <class N>
+bool numeric_is_zero(const N &v) { return v.is_zero(); }
+template <class N>
+bool numeric_is_negative(const N &v) { return v.is_negative(); }
+template <class N>
+std::string numeric_abs_string(const N &v) { return v.abs_string(); }
+
+// base^exp by repeated squaring.
+template <class N>
+N numeric_power(N base, long long exp)
+{
+    N result(1);
+    while (exp > 0)
+    {
+        if (exp & 1)
+        {
+            result = result * base;
+        }
+        exp >>= 1;
+        if (exp > 0)
+        {
+            base = base * base;
+        }
+    }
+    return result;
+}
+
+#endif
@@ -1,98 +1,528 @@
 #include <iostream>
 #include <algorithm>
 #include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <cstring>
 #include "parser.h"
 #include <set>
 #include <cmath>
+#include <thread>
+#include <cerrno>
+#include <unistd.h>
 
 using namespace std;
 
-void Parser::ParseInput()
+void Parser::parse_and_check()
 {
+    // A cached image was checked when it was written. One that does not
+    // decode is parsed again and rewritten; on a hit the lexer was given
+    // nothing, so it is given the source now.
+    if (program_cache && program_cache->is_open())
+    {
+        if (load_program(*program_cache))
+        {
+            return;
+        }
+        lexer.Push(program_source);
+        lexer.Finish();
+    }
+    // A pushed program was parsed and checked by finish().
+    if (push_started)
+    {
+        return;
+    }
     parse_program();
     expect(END_OF_FILE); // Ensures we consume the entire input
     if (!errors.empty())
     {
         report_errors();
     }
-    else
+    if (program_cache && !ProgramCache::save(program_cache_path, program_source_hash, serialize_program()))
     {
-        bool execute = false;
-        for (int task : tasks)
+        error_stream << "cannot write program cache " << program_cache_path << endl;
+    }
+}
+
+void Parser::ParseInput()
+{
+    parse_and_check();
+    bool execute = false;
+    for (int task : tasks)
+    {
+        if (task == 2)
+        {
+            execute = true;
+            break;
+        }
+    }
+    if (execute)
+    {
+        optimize_program();
+
+        // Closed forms assume every INPUT statement gets a value; with too
+        // few inputs, or an expansion over budget, interpret instead.
+        if (numeric_mode != NUMERIC_INT32)
         {
-            if (task == 2)
+            execute_numeric();
+        }
+        else if (native_mode && prepare_native())
+        {
+            string out;
+            run_native(inputs, out);
+            output_stream << out;
+        }
+        else if (closed_form_mode && compile_closed_forms() && inputs.size() >= closed_form_inputs)
+        {
+            execute_closed_forms(inputs);
+        }
+        else
+        {
+            if (native_mode)
+            {
+                error_stream << "native code unavailable, interpreting the EXECUTE section" << endl;
+            }
+            if (closed_form_mode)
             {
-                execute = true;
-                break;
+                error_stream << "closed form unavailable, interpreting the EXECUTE section" << endl;
             }
+            execute_program();
         }
-        if (execute)
+    }
+
+    bool task3 = false;
+    for (int task : tasks)
+    {
+        if (task == 3)
         {
-            execute_program();
+            task3 = true;
+            break;
+        }
+    }
+    if (task3)
+    {
+        output_stream << "POLY - SORTED MONOMIAL LISTS" << endl;
+        for (const auto &poly_name : poly_order)
+        {
+            print_poly_task3(symbolTable.at(poly_name));
         }
+    }
 
-        bool task3 = false;
-        for (int task : tasks)
+    bool task4 = false;
+    for (int task : tasks)
+    {
+        if (task == 4)
         {
-            if (task == 3)
-            {
-                task3 = true;
-                break;
-            }
+            task4 = true;
+            break;
+        }
+    }
+    if (task4)
+    {
+        output_stream << "POLY - COMBINED MONOMIAL LISTS" << endl;
+        for (const auto &poly_name : poly_order)
+        {
+            print_poly_task4(symbolTable.at(poly_name));
+        }
+    }
+
+    bool task5 = false;
+    for (int task : tasks)
+    {
+        if (task == 5)
+        {
+            task5 = true;
+            break;
+        }
+    }
+    if (task5)
+    {
+        output_stream << "POLY - EXPANDED" << endl;
+        for (const auto &poly_name : poly_order)
+        {
+            print_poly_task5(symbolTable.at(poly_name));
         }
-        if (task3)
+    }
+
+    bool task6 = false;
+    for (int task : tasks)
+    {
+        if (task == 6)
         {
-            cout << "POLY - SORTED MONOMIAL LISTS" << endl;
-            for (const auto &poly_name : poly_order)
+            task6 = true;
+            break;
+        }
+    }
+    if (task6)
+    {
+        print_identities();
+    }
+}
+
+ProgramStatus Parser::RunProgram()
+{
+    try
+    {
+        ParseInput();
+    }
+    catch (const ProgramError &e)
+    {
+        output_stream << e.report;
+        output_stream.flush();
+        return e.status;
+    }
+    return PROGRAM_OK;
+}
+
+// Evaluates one univariate polynomial at every number of the INPUTS
+// section, printing one value per line, instead of running the tasks.
+void Parser::SweepInput(const std::string &poly_name)
+{
+    parse_and_check();
+    if (symbolTable.count(poly_name) == 0 || symbolTable.at(poly_name).parameters.size() != 1)
+    {
+        cerr << "--sweep needs a declared polynomial with one parameter: " << poly_name << endl;
+        exit(1);
+    }
+    for (int value : eval_poly_batch(symbolTable.at(poly_name), inputs))
+    {
+        output_stream << value << endl;
+    }
+}
+
+// ... main function ...
+
+static void usage(const char *prog)
+{
+    cerr << "Usage: " << prog << " [options] [program-file]" << endl;
+    cerr << "       " << prog << " [options] --batch program-file..." << endl;
+    cerr << "  (the program is read from stdin when no file is given)" << endl;
+    cerr << "  --max-terms=N    stop Task 5 expansion of a polynomial after N terms" << endl;
+    cerr << "  --threads=N      expand large products on N threads (with --batch, run N programs" << endl;
+    cerr << "                   at a time)" << endl;
+    cerr << "  --batch          run every program file given, each on its own parser, and print" << endl;
+    cerr << "                   their outputs in order under a ==> file <== header" << endl;
+    cerr << "  --memo[=N]       cache up to N (default 65536) polynomial call results" << endl;
+    cerr << "  --closed-form[=N]" << endl;
+    cerr << "                   run EXECUTE as one compiled polynomial per OUTPUT when the" << endl;
+    cerr << "                   closed forms stay within N (default 4096) terms" << endl;
+    cerr << "  --native[=DIR]   compile the program to native code with the system compiler and" << endl;
+    cerr << "                   run EXECUTE with it, keeping the compiled programs in DIR" << endl;
+    cerr << "                   (default ~/.cache/polynomial-parser, which must be private)" << endl;
+    cerr << "  --fold           fold constant polynomial calls and specialize partly constant ones" << endl;
+    cerr << "  --dce            remove assignments that no OUTPUT reads" << endl;
+    cerr << "  --cse            evaluate repeated calls once and reuse the result" << endl;
+    cerr << "  -O               enable every optimization pass" << endl;
+    cerr << "  --numeric=MODE   evaluate and expand in int32 (default, wraps), checked64" << endl;
+    cerr << "                   (reports overflow) or bigint (exact)" << endl;
+    cerr << "  --modulus=P      evaluate and expand modulo the odd number P < 2^63" << endl;
+    cerr << "  --stream=FILE    run EXECUTE once per line of FILE (- for stdin), each line" << endl;
+    cerr << "                   holding the INPUTS of one run" << endl;
+    cerr << "  --cache-dir=DIR  keep the parsed program in DIR, keyed by a hash of its source," << endl;
+    cerr << "                   and load it from there when the source is unchanged" << endl;
+    cerr << "  --session        run the program, then rerun it for each INPUTS line read from" << endl;
+    cerr << "                   stdin, recomputing only what the changed inputs affect" << endl;
+    cerr << "  --serve=PATH     answer EVAL/RUN/STATS/SHUTDOWN requests on the UNIX socket PATH" << endl;
+    cerr << "                   (- for stdin and stdout) until shut down" << endl;
+    cerr << "  --sweep=NAME     print the univariate polynomial NAME at every INPUTS value" << endl;
+    cerr << "  --bench-batch=NAME[:COUNT]" << endl;
+    cerr << "                   time batch evaluation of NAME on COUNT random argument tuples" << endl;
+    exit(1);
+}
+
+// Hands the program to the parser as it arrives, so every section is
+// parsed while the rest is still being read. Standard input is read with
+// read(2), which returns what a pipe holds instead of waiting for a full
+// buffer.
+static void push_program(Parser &parser, istream *file)
+{
+    char chunk[1 << 16];
+    while (true)
+    {
+        ssize_t n;
+        if (file)
+        {
+            file->read(chunk, sizeof(chunk));
+            n = file->gcount();
+        }
+        else
+        {
+            n = read(0, chunk, sizeof(chunk));
+            if (n < 0 && errno == EINTR)
             {
-                print_poly_task3(symbolTable.at(poly_name));
+                continue;
             }
         }
+        if (n <= 0)
+        {
+            break;
+        }
+        parser.push(chunk, n);
+    }
+    parser.finish();
+}
 
-        bool task4 = false;
-        for (int task : tasks)
+int main(int argc, char *argv[])
+{
+    // Options are collected first and applied to each parser once it is
+    // made, so a batch can give every program a parser of its own.
+    vector<ParserSetting> settings;
+    vector<string> program_paths;
+    unsigned num_threads = 0;
+    bool batch = false;
+    string cache_dir;
+    string sweep_name;
+    string stream_path;
+    bool session = false;
+    string serve_path;
+    string bench_name;
+    size_t bench_count = 1000000;
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg.rfind("--max-terms=", 0) == 0)
+        {
+            size_t limit = strtoull(arg.c_str() + 12, nullptr, 10);
+            settings.push_back([limit](Parser &parser) { parser.set_max_expanded_terms(limit); });
+        }
+        else if (arg.rfind("--threads=", 0) == 0)
+        {
+            num_threads = atoi(arg.c_str() + 10);
+        }
+        else if (arg == "--memo" || arg.rfind("--memo=", 0) == 0)
+        {
+            size_t max_entries = (arg == "--memo") ? 65536 : strtoull(arg.c_str() + 7, nullptr, 10);
+            settings.push_back([max_entries](Parser &parser) { parser.enable_memo(max_entries); });
+        }
+        else if (arg == "--closed-form" || arg.rfind("--closed-form=", 0) == 0)
+        {
+            size_t max_terms = (arg == "--closed-form") ? 4096 : strtoull(arg.c_str() + 14, nullptr, 10);
+            settings.push_back([max_terms](Parser &parser) { parser.enable_closed_form(max_terms); });
+        }
+        else if (arg == "--native" || arg.rfind("--native=", 0) == 0)
         {
-            if (task == 4)
+            string dir = arg.substr(arg == "--native" ? 8 : 9);
+            if (dir.empty())
             {
-                task4 = true;
-                break;
+                dir = NativeModule::default_dir();
             }
+            settings.push_back([dir](Parser &parser) { parser.enable_native(dir); });
         }
-        if (task4)
+        else if (arg == "--fold" || arg == "--dce" || arg == "--cse" || arg == "-O")
         {
-            cout << "POLY - COMBINED MONOMIAL LISTS" << endl;
-            for (const auto &poly_name : poly_order)
+            int flags = (arg == "--fold") ? OPT_FOLD : (arg == "--dce") ? OPT_DCE : (arg == "--cse") ? OPT_CSE : OPT_ALL;
+            settings.push_back([flags](Parser &parser) { parser.enable_optimizations(flags); });
+        }
+        else if (arg.rfind("--numeric=", 0) == 0)
+        {
+            string mode_name = arg.substr(10);
+            NumericMode mode;
+            if (mode_name == "int32")
             {
-                print_poly_task4(symbolTable.at(poly_name));
+                mode = NUMERIC_INT32;
             }
+            else if (mode_name == "checked64")
+            {
+                mode = NUMERIC_CHECKED64;
+            }
+            else if (mode_name == "bigint")
+            {
+                mode = NUMERIC_BIGINT;
+            }
+            else
+            {
+                usage(argv[0]);
+            }
+            settings.push_back([mode](Parser &parser) { parser.set_numeric_mode(mode); });
         }
-
-        bool task5 = false;
-        for (int task : tasks)
+        else if (arg.rfind("--modulus=", 0) == 0)
         {
-            if (task == 5)
+            unsigned long long modulus = strtoull(arg.c_str() + 10, nullptr, 10);
+            if (modulus < 3 || modulus % 2 == 0 || modulus >> 63)
             {
-                task5 = true;
-                break;
+                cerr << "--modulus needs an odd modulus between 3 and 2^63" << endl;
+                exit(1);
             }
+            ModInt::set_modulus(modulus);
+            settings.push_back([](Parser &parser) { parser.set_numeric_mode(NUMERIC_MODULAR); });
         }
-        if (task5)
+        else if (arg == "--batch")
         {
-            cout << "POLY - EXPANDED" << endl;
-            for (const auto &poly_name : poly_order)
+            batch = true;
+        }
+        else if (arg.rfind("--cache-dir=", 0) == 0)
+        {
+            cache_dir = arg.substr(12);
+        }
+        else if (arg.rfind("--stream=", 0) == 0)
+        {
+            stream_path = arg.substr(9);
+        }
+        else if (arg == "--session")
+        {
+            session = true;
+        }
+        else if (arg.rfind("--serve=", 0) == 0)
+        {
+            serve_path = arg.substr(8);
+        }
+        else if (arg[0] != '-')
+        {
+            program_paths.push_back(arg);
+        }
+        else if (arg.rfind("--sweep=", 0) == 0)
+        {
+            sweep_name = arg.substr(8);
+        }
+        else if (arg.rfind("--bench-batch=", 0) == 0)
+        {
+            bench_name = arg.substr(14);
+            size_t colon = bench_name.find(':');
+            if (colon != string::npos)
             {
-                print_poly_task5(symbolTable.at(poly_name));
+                bench_count = strtoull(bench_name.c_str() + colon + 1, nullptr, 10);
+                bench_name.resize(colon);
             }
         }
+        else
+        {
+            usage(argv[0]);
+        }
     }
-}
 
-// ... main function ...
+    if (batch)
+    {
+        if (!cache_dir.empty() || !stream_path.empty() || session || !serve_path.empty() || !sweep_name.empty() ||
+            !bench_name.empty())
+        {
+            cerr << "--batch runs the tasks of each program and takes no other mode" << endl;
+            exit(1);
+        }
+        if (num_threads == 0)
+        {
+            num_threads = thread::hardware_concurrency();
+        }
+        return run_program_batch(program_paths, settings, num_threads) == 0 ? 0 : 1;
+    }
+    if (program_paths.size() > 1)
+    {
+        usage(argv[0]);
+    }
 
-int main()
-{
-    Parser parser;
-    parser.ParseInput();
+    istream *source = &cin;
+    ifstream program_file;
+    if (!program_paths.empty())
+    {
+        program_file.open(program_paths[0]);
+        if (!program_file)
+        {
+            cerr << "cannot open program file " << program_paths[0] << endl;
+            exit(1);
+        }
+        source = &program_file;
+    }
+
+    // With a program cache the source is read up front to find its image;
+    // on a hit the lexer is given nothing to tokenize. Otherwise the parser
+    // starts empty and the program is pushed to it as it is read.
+    ProgramCache cache;
+    istringstream program_text;
+    string cache_path;
+    string program_source;
+    uint64_t source_hash = 0;
+    if (!cache_dir.empty())
+    {
+        program_source.assign(istreambuf_iterator<char>(*source), istreambuf_iterator<char>());
+        source_hash = ProgramCache::hash_source(program_source);
+        cache_path = ProgramCache::path_for(cache_dir, source_hash);
+        if (!cache.open(cache_path, source_hash))
+        {
+            program_text.str(program_source);
+        }
+    }
+    Parser parser(program_text, cout, cerr);
+    if (!cache_dir.empty())
+    {
+        parser.use_program_cache(&cache, cache_path, program_source, source_hash);
+    }
+    for (const ParserSetting &setting : settings)
+    {
+        setting(parser);
+    }
+    if (num_threads != 0)
+    {
+        parser.set_num_threads(num_threads);
+    }
+
+    try
+    {
+        if (cache_dir.empty())
+        {
+            if (!serve_path.empty())
+            {
+                parser.compile_polys_on_push();
+            }
+            push_program(parser, program_file.is_open() ? &program_file : nullptr);
+        }
+        if (!serve_path.empty())
+        {
+            if (serve_path == "-" && !program_file.is_open())
+            {
+                cerr << "--serve=- reads requests from stdin, so the program must come from a file" << endl;
+                exit(1);
+            }
+            parser.Serve(serve_path);
+        }
+        else if (session)
+        {
+            if (!program_file.is_open())
+            {
+                cerr << "--session reads INPUTS lines from stdin, so the program must come from a file" << endl;
+                exit(1);
+            }
+            parser.SessionInputs(cin);
+        }
+        else if (!stream_path.empty())
+        {
+            if (stream_path == "-")
+            {
+                if (!program_file.is_open())
+                {
+                    cerr << "--stream=- reads batches from stdin, so the program must come from a file" << endl;
+                    exit(1);
+                }
+                parser.StreamInputs(cin);
+            }
+            else
+            {
+                ifstream batches(stream_path);
+                if (!batches)
+                {
+                    cerr << "cannot open batch file " << stream_path << endl;
+                    exit(1);
+                }
+                parser.StreamInputs(batches);
+            }
+        }
+        else if (!sweep_name.empty())
+        {
+            parser.SweepInput(sweep_name);
+        }
+        else if (!bench_name.empty())
+        {
+            parser.BenchBatch(bench_name, bench_count);
+        }
+        else
+        {
+            parser.ParseInput();
+        }
+    }
+    catch (const ProgramError &e)
+    {
+        cout << e.report;
+        return 1;
+    }
 
     return 0;
-}
\ No newline at end of file
+}
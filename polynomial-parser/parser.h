@@ -6,6 +6,25 @@
 #include <vector>
 #include <map> // Include the map header
 #include <set>
+#include <unordered_map>
+#include <memory>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <functional>
+#include <atomic>
+#include <tuple>
+#include <thread>
+#include <exception>
+#include "thread_pool.h"
+#include "dense_poly.h"
+#include "compiled_poly.h"
+#include "memo_cache.h"
+#include "arena.h"
+#include "numeric.h"
+#include "program_cache.h"
+#include "native_module.h"
+#include "latency_histogram.h"
 
 // Forward declarations
 class Parser;
@@ -15,9 +34,13 @@ struct Term;
 
 // Represents the body of a polynomial as a list of terms.
 // Each term is associated with an operator (+ or -).
+// Structurally identical bodies parsed against the same parameter list are
+// one shared node; a shared body is evaluated and expanded once per call.
 struct PolyBody
 {
     std::vector<std::pair<char, Term *>> terms;
+    int id = -1;         // Index among the distinct parsed bodies, -1 if built later
+    bool shared = false; // Reached from more than one place
 };
 
 // Represents a term in a polynomial expression.
@@ -30,11 +53,25 @@ struct Term
     std::vector<PolyBody *> parenthesized_lists;        // For products of parenthesized expressions
 };
 
+// Expanded form of a polynomial body: each monomial power vector maps to
+// its combined coefficient, of one of the number types of numeric.h. Zero
+// coefficients are never stored.
+template <class N>
+using Expansion = std::map<std::vector<int>, N>;
+typedef Expansion<int> MonomialMap;
+
+// Thrown when an expansion grows past the configured term budget.
+struct ExpansionLimitExceeded
+{
+    size_t limit;
+};
+
 struct Polynomial
 {
     std::string name;
     std::vector<std::string> parameters;
     int line_no;
+    int index; // Position in declaration order
     PolyBody *body; // Representation of the polynomial body for evaluation
     bool explicit_parameters;
 };
@@ -47,12 +84,16 @@ enum ValueType
 };
 
 // Represents a value, which can be a number, a variable, or a polynomial evaluation.
+// Variables are resolved to their memory location when they are parsed.
 struct Value
 {
     ValueType type;
-    int value;           // For NUM_TYPE
-    std::string id;      // For ID_TYPE
-    PolyEval *poly_eval; // For POLY_EVAL_TYPE
+    union
+    {
+        int value;           // For NUM_TYPE
+        int location;        // For ID_TYPE
+        PolyEval *poly_eval; // For POLY_EVAL_TYPE
+    };
 };
 
 // Represents a polynomial evaluation, e.g., F(arg1, arg2)
@@ -66,33 +107,118 @@ enum StatementType
 {
     INPUT_STMT,
     OUTPUT_STMT,
-    ASSIGN_STMT
+    ASSIGN_STMT,
+    COPY_STMT // id = number or variable; only created by the optimization passes
 };
 
 // Represents a single statement in the EXECUTE section.
 struct StatementNode
 {
     StatementType type;
-    std::string id;          // Variable name for INPUT, OUTPUT, and LHS of ASSIGN
-    PolyEval *poly_eval; // For ASSIGN_STMT
+    int location; // Memory location of the variable read, written or output
+    union
+    {
+        PolyEval *poly_eval; // For ASSIGN_STMT
+        Value *value;        // For COPY_STMT
+    };
+};
+
+// How a program run ended. Errors are reported on the output stream with
+// the same text the command line prints before exiting with status 1.
+enum ProgramStatus
+{
+    PROGRAM_OK,
+    PROGRAM_SYNTAX_ERROR,
+    PROGRAM_SEMANTIC_ERROR
+};
+
+// Thrown by syntax_error and report_errors, and caught by RunProgram and main.
+struct ProgramError
+{
+    ProgramStatus status;
+    std::string report;
+};
+
+// Optimization passes over the EXECUTE IR, selected with command-line flags.
+enum OptimizationFlag
+{
+    OPT_FOLD = 1, // Constant folding and specialization of partly constant calls
+    OPT_DCE = 2,  // Removal of assignments no OUTPUT can observe
+    OPT_CSE = 4,  // Reuse of repeated calls on the same reaching definitions
+    OPT_ALL = OPT_FOLD | OPT_DCE | OPT_CSE
 };
 
 // --- Execution and Evaluation Functions ---
+CompiledPoly compile_monomials(const MonomialMap &expanded, size_t arity);
 int eval_poly(PolyEval *pe, Parser *parser);
-int eval_poly_body(PolyBody *body, const std::vector<std::string> &params, const std::map<std::string, int> &arg_values, Parser *parser);
-int eval_term(Term *term, const std::vector<std::string> &params, const std::map<std::string, int> &arg_values, Parser *parser);
+int eval_poly(PolyEval *pe, Parser *parser, const std::vector<int> &mem);
+// Tree evaluation in any number type of numeric.h, instantiated in
+// parser_eval.cc. A parameter missing from arg_values is zero.
+template <class N>
+N eval_poly_body(PolyBody *body, const std::vector<std::string> &params, const std::map<std::string, N> &arg_values, Parser *parser);
+template <class N>
+N eval_term(Term *term, const std::vector<std::string> &params, const std::map<std::string, N> &arg_values, Parser *parser);
 int eval_value(Value *v, Parser *parser);
+int eval_value(Value *v, Parser *parser, const std::vector<int> &mem);
+int count_terms(PolyBody *body); // Terms of a body, counting nested lists
+bool parse_batch(const std::string &line, std::vector<int> &batch); // One line of numbers
+
+// Applies one command-line option to a parser.
+typedef std::function<void(Parser &)> ParserSetting;
+
+// Runs every program file with its own parser, on num_threads threads, and
+// writes the outputs in the order of the files. Returns how many programs
+// could not be read or did not parse and check.
+size_t run_program_batch(const std::vector<std::string> &paths, const std::vector<ParserSetting> &settings,
+                         unsigned num_threads);
 
 class Parser
 {
     friend int eval_poly(PolyEval *pe, Parser *parser);
     friend int eval_value(Value *v, Parser *parser);
+    friend int eval_poly(PolyEval *pe, Parser *parser, const std::vector<int> &mem);
+    friend int eval_value(Value *v, Parser *parser, const std::vector<int> &mem);
 
 public:
+    // The program is read from the stream when the parser is made.
+    Parser();
+    Parser(std::istream &program, std::ostream &output, std::ostream &diagnostics);
+    ~Parser();
+
+    // Push parsing, for a parser made with an empty stream: the program is
+    // given in chunks and each section is parsed once its tokens arrive.
+    // finish() must come before any of the entry points below, and throws
+    // the program's errors. The results of a section can be read once its
+    // *_parsed() is true; a syntax error later on still fails the program.
+    void push(const char *data, size_t size);
+    void finish();
+    void compile_polys_on_push(); // Compile the polynomials as --serve does once POLY is done
+    bool tasks_parsed() const;
+    const std::vector<int> &parsed_tasks() const;
+    bool polys_parsed() const;
+    const std::map<std::string, std::vector<int>> &poly_section_errors() const;
+    const CompiledPoly *compiled_poly(const std::string &name) const; // Null if not compiled
+
     void ParseInput();
+    ProgramStatus RunProgram(); // ParseInput, with errors returned instead of thrown
+    void SweepInput(const std::string &poly_name);
+    void BenchBatch(const std::string &poly_name, size_t count);
+    void StreamInputs(std::istream &batches);
+    void SessionInputs(std::istream &batches);
+    void Serve(const std::string &path);
+    void set_max_expanded_terms(size_t limit);
+    void set_num_threads(unsigned num_threads);
+    void enable_memo(size_t max_entries);
+    void enable_closed_form(size_t max_terms);
+    void enable_native(const std::string &dir); // Cache directory of the compiled programs
+    void enable_optimizations(int flags);
+    void set_numeric_mode(NumericMode mode);
+    void use_program_cache(ProgramCache *cache, const std::string &path, const std::string &source, uint64_t source_hash);
 
 private:
     LexicalAnalyzer lexer;
+    std::ostream &output_stream; // What the tasks print
+    std::ostream &error_stream;  // Statistics and notes on the chosen strategy
     void parse_id_list(std::vector<std::string> &params);
     void syntax_error();
     void report_errors();
@@ -102,24 +228,189 @@ private:
 
     std::vector<std::string> poly_order;
     std::vector<int> tasks;
+    Arena ast;                            // Owns every AST and IR node of this parse
     std::vector<StatementNode *> program; // IR for EXECUTE section
     std::vector<int> inputs;              // Stored inputs from INPUTS section
     std::map<std::string, int> location_table;
     std::vector<int> mem;
     int next_location = 0;
     int next_input = 0;
+    std::unique_ptr<MemoCache> memo; // Opt-in cache of eval_poly results
+
+    void parse_and_check();
+
+    // --- Push Parsing ---
+    std::thread push_thread;
+    bool push_started = false;
+    bool compile_on_push = false;
+    std::exception_ptr push_error; // Rethrown by finish()
+    std::atomic<bool> tasks_done{false};
+    std::atomic<bool> polys_done{false};
+    std::map<std::string, std::vector<int>> poly_errors; // errors as of the end of POLY
+    void parse_pushed_program();
+
+    // --- Program Cache ---
+    ProgramCache *program_cache = nullptr; // Set with --cache-dir; open when the image was found
+    std::string program_cache_path;
+    std::string program_source; // Lexed again if the image does not decode
+    uint64_t program_source_hash = 0;
+    std::string serialize_program();
+    bool load_program(const ProgramCache &cache); // False if the image does not decode
 
     // --- Execution Helper ---
     void execute_program();
+    std::vector<int> eval_poly_batch(const Polynomial &poly, const std::vector<int> &points);
+    CompiledPoly compile_polynomial(const Polynomial &poly);
+    void execute_statement(StatementNode *stmt);
+
+    // --- Dataflow Execution ---
+    void execute_dataflow(size_t begin, size_t end);
+    void collect_uses(Value *v, std::vector<int> &uses);
+    long long call_cost(Value *v);
+
     int get_location(const std::string &id);
 
+    // --- Symbolic Evaluation ---
+    // Evaluates bodies on polynomial arguments over symbolic_vars variables.
+    // Between begin_symbolic and end_symbolic the expansion term budget is
+    // replaced by the (usually much tighter) symbolic one.
+    size_t symbolic_vars = 0;
+    size_t symbolic_max_terms = 4096;
+    size_t saved_max_terms = 0;
+    void begin_symbolic(size_t num_vars, size_t max_terms);
+    void end_symbolic();
+    MonomialMap symbolic_constant(int value);
+    MonomialMap symbolic_value(Value *v, const std::vector<MonomialMap> &sym_mem);
+    MonomialMap symbolic_poly_eval(PolyEval *pe, const std::vector<MonomialMap> &sym_mem);
+    MonomialMap symbolic_body(PolyBody *body, const std::vector<MonomialMap> &args);
+    MonomialMap symbolic_call(const Polynomial &poly, const std::vector<MonomialMap> &args);
+    MonomialMap symbolic_power(const MonomialMap &base, int exp);
+    MonomialMap symbolic_multiply(const MonomialMap &a, const MonomialMap &b);
+
+    // --- Optimization Passes ---
+    int optimizations = 0;
+    std::set<std::string> unspecializable; // Specialization keys that did not pay off
+    void optimize_program();
+    void fold_constants();
+    bool fold_value(Value *v, const std::vector<bool> &known, const std::vector<int> &known_value, int &folded, int &specialized);
+    bool fold_poly_eval(PolyEval *pe, const std::vector<bool> &known, const std::vector<int> &known_value, int &folded, int &specialized);
+    bool specialize_call(PolyEval *pe);
+    void eliminate_dead_statements();
+    void mark_live(Value *v, std::vector<bool> &live);
+    void eliminate_common_subexpressions();
+    std::string value_number(Value *v, const std::vector<int> &version);
+    void count_subexpressions(Value *v, const std::vector<int> &version, std::map<std::string, int> &counts);
+    void reuse_subexpressions(Value *v, const std::vector<int> &version, const std::map<std::string, int> &counts,
+                              std::map<std::string, int> &temps, std::vector<StatementNode *> &out, int &reused);
+
+    // --- Closed-form Execution ---
+    // Each OUTPUT of the EXECUTE section as a polynomial in the values read
+    // by the INPUT statements, numbered in program order.
+    bool closed_form_mode = false;
+    size_t closed_form_max_terms = 4096;
+    size_t closed_form_inputs = 0;
+    std::vector<CompiledPoly> closed_forms;
+    bool compile_closed_forms();
+    void execute_closed_forms(const std::vector<int> &input_values);
+
+    // --- Native Code ---
+    // The program compiled to a shared object; native_ready once it is
+    // loaded and, when newly built, checked against the interpreter.
+    bool native_mode = false;
+    bool native_ready = false;
+    std::string native_dir;
+    NativeModule native_module;
+    const NativePoly *native_polys = nullptr; // By declaration index
+    NativeExecute native_execute = nullptr;
+    size_t native_outputs = 0;
+    std::string emit_native_source();
+    void emit_native_poly(const Polynomial &poly, int index, std::ostringstream &out);
+    std::string emit_native_value(Value *v, const std::map<std::string, int> &functions);
+    bool bind_native();
+    bool check_native();
+    bool prepare_native();
+    void run_native(const std::vector<int> &batch, std::string &out);
+
+    // --- Stream Execution ---
+    void prepare_batch_runs();
+    void run_batch(const std::vector<int> &batch, std::string &out);
+
+    // --- Evaluation Server ---
+    std::vector<CompiledPoly> compiled_polys; // By declaration index, also made by push parsing
+    std::vector<bool> polys_compiled;         // Whether compiled_polys holds the polynomial
+    LatencyHistogram request_latency;
+    std::atomic<bool> serve_stopping{false};
+    int serve_listener = -1;
+    void compile_polys();
+    std::string answer_request(const std::string &request);
+    void serve_connection(int in_fd, int out_fd);
+    void serve_socket(const std::string &path);
+
+    // --- Incremental Session ---
+    std::vector<std::vector<int>> statement_uses; // Locations each statement reads
+    std::vector<int> statement_values;            // What each statement wrote in the last run
+    bool session_started = false;
+    size_t session_recomputed = 0;
+    size_t session_total = 0;
+    void prepare_session();
+    void run_session_batch(const std::vector<int> &batch, std::string &out);
+
+    // --- Numeric Modes ---
+    // Task 2 and Task 5 in a number type other than the wrapping int.
+    NumericMode numeric_mode = NUMERIC_INT32;
+    void execute_numeric();
+    void run_batch_numeric(const std::vector<int> &batch, std::string &out);
+    void print_poly_task5_numeric(const Polynomial &poly);
+    template <class N>
+    N eval_value_as(Value *v, const std::vector<N> &values);
+    template <class N>
+    N eval_poly_as(PolyEval *pe, const std::vector<N> &values);
+    template <class N>
+    void run_batch_as(const std::vector<int> &batch, std::string &out);
+    template <class N>
+    void print_expansion_as(const Polynomial &poly);
+
     // --- Printing Functions ---
     void print_poly_task3(const Polynomial &poly);
     void print_poly_body_task3(const PolyBody *body, const Polynomial &poly);
     void print_poly_task4(const Polynomial &poly);
     void print_poly_body_task4(PolyBody *body, const Polynomial &poly);
     void print_poly_task5(const Polynomial &poly);
-    PolyBody* expand_poly_body(PolyBody *body, const Polynomial &poly);
+    void print_identities();
+    template <class N>
+    void print_expanded_terms(const std::map<std::vector<int>, N> &combined_terms, const Polynomial &poly);
+
+    // --- Expansion Engine (Task 5) ---
+    size_t max_expanded_terms = 1000000;
+    std::unique_ptr<ThreadPool> pool; // Set when more than one thread is requested
+    // Templated on the coefficient type and instantiated in parser_expand.cc
+    // for int and the numeric modes.
+    template <class N>
+    Expansion<N> expand_poly_body(PolyBody *body, const Polynomial &poly);
+    template <class N>
+    Expansion<N> expand_term(Term *term, const Polynomial &poly);
+    template <class N>
+    Expansion<N> expand_product(std::vector<Expansion<N>> &factors, size_t lo, size_t hi);
+    template <class N>
+    Expansion<N> multiply_expansions(const Expansion<N> &a, const Expansion<N> &b);
+    template <class N>
+    Expansion<N> multiply_expansions_parallel(const Expansion<N> &a, const Expansion<N> &b);
+    template <class N>
+    void multiply_range(typename Expansion<N>::const_iterator first, typename Expansion<N>::const_iterator last,
+                        const Expansion<N> &b, Expansion<N> &product);
+    template <class N>
+    void add_expansion(Expansion<N> &total, const Expansion<N> &m, int sign);
+    template <class N = int>
+    Expansion<N> expand_polynomial(const Polynomial &poly);
+    template <class N>
+    using SharedExpansions = std::map<PolyBody *, Expansion<N>>;
+    // Of the polynomial being expanded, one map per coefficient type
+    std::tuple<SharedExpansions<int>, SharedExpansions<Checked64>, SharedExpansions<BigInt>, SharedExpansions<ModInt>>
+        shared_expansions;
+    std::map<PolyBody *, DensePoly> shared_dense_expansions;
+    long long max_degree(PolyBody *body);
+    DensePoly expand_poly_body_dense(PolyBody *body);
+    DensePoly expand_term_dense(Term *term);
 
     // Add declarations for your parsing functions here
     void parse_program();
@@ -131,6 +422,13 @@ private:
     void parse_poly_decl();
     void parse_poly_header(Polynomial &poly);
     PolyBody *parse_poly_body(const Polynomial &poly);
+    PolyBody *intern_body(PolyBody *body, const Polynomial &poly);
+    struct BodyKeyHash
+    {
+        size_t operator()(const std::vector<int> &key) const;
+    };
+    std::unordered_map<std::vector<int>, PolyBody *, BodyKeyHash> interned_bodies;
+    std::map<std::vector<std::string>, int> parameter_lists;
     void parse_term_list_prime(const Polynomial &poly, PolyBody *body);
     Term *parse_term(const Polynomial &poly);
     void parse_parenthesized_list(const Polynomial &poly, Term *term);
@@ -0,0 +1,173 @@
+#include "parser.h"
+#include <iostream>
+#include <vector>
+#include <map>
+#include <set>
+#include <chrono>
+#include <random>
+
+using namespace std;
+
+CompiledPoly compile_monomials(const MonomialMap &expanded, size_t arity)
+{
+    CompiledPoly compiled;
+    compiled.arity = arity;
+
+    set<pair<int, int>> used_powers; // (variable, exponent), in slot order
+    for (const auto &term : expanded)
+    {
+        for (size_t i = 0; i < term.first.size(); ++i)
+        {
+            if (term.first[i] > 0)
+            {
+                used_powers.insert({(int)i, term.first[i]});
+            }
+        }
+    }
+    map<pair<int, int>, uint32_t> slot_of;
+    for (const auto &power : used_powers)
+    {
+        slot_of[power] = compiled.slot_var.size();
+        compiled.slot_var.push_back(power.first);
+        compiled.slot_exp.push_back(power.second);
+    }
+
+    compiled.term_start.push_back(0);
+    for (const auto &term : expanded)
+    {
+        compiled.coefficients.push_back((uint32_t)term.second);
+        for (size_t i = 0; i < term.first.size(); ++i)
+        {
+            if (term.first[i] > 0)
+            {
+                compiled.term_slots.push_back(slot_of[{(int)i, term.first[i]}]);
+            }
+        }
+        compiled.term_start.push_back(compiled.term_slots.size());
+    }
+    specialize_fixed_arity(compiled);
+    return compiled;
+}
+
+CompiledPoly Parser::compile_polynomial(const Polynomial &poly)
+{
+    // Throws ExpansionLimitExceeded when the body does not expand within the
+    // term budget.
+    return compile_monomials(expand_polynomial(poly), poly.parameters.size());
+}
+
+// Times the generic tree evaluator against the compiled form, one tuple at
+// a time and in batches, on count random argument tuples and reports
+// evaluations per second.
+void Parser::BenchBatch(const std::string &poly_name, size_t count)
+{
+    parse_and_check();
+    if (symbolTable.count(poly_name) == 0)
+    {
+        cerr << "--bench-batch needs a declared polynomial: " << poly_name << endl;
+        exit(1);
+    }
+    const Polynomial &poly = symbolTable.at(poly_name);
+    size_t arity = poly.parameters.size();
+
+    CompiledPoly compiled;
+    try
+    {
+        compiled = compile_polynomial(poly);
+    }
+    catch (const ExpansionLimitExceeded &e)
+    {
+        cerr << poly_name << " does not expand within " << e.limit << " terms" << endl;
+        exit(1);
+    }
+
+    mt19937 rng(12345);
+    uniform_int_distribution<int> dist(-1000, 1000);
+    vector<vector<int>> columns(arity, vector<int>(count));
+    for (auto &column : columns)
+    {
+        for (int &v : column)
+        {
+            v = dist(rng);
+        }
+    }
+    // The tree evaluator gives a repeated parameter name its last argument
+    // and the compiled form reads its first, so every position of such a
+    // name gets the same values.
+    for (size_t i = 0; i < arity; ++i)
+    {
+        for (size_t j = i + 1; j < arity; ++j)
+        {
+            if (poly.parameters[j] == poly.parameters[i])
+            {
+                columns[i] = columns[j];
+            }
+        }
+    }
+
+    typedef chrono::steady_clock Clock;
+    vector<int> generic(count), batch(count);
+
+    Clock::time_point start = Clock::now();
+    map<string, int> arg_values;
+    for (size_t j = 0; j < count; ++j)
+    {
+        for (size_t i = 0; i < arity; ++i)
+        {
+            arg_values[poly.parameters[i]] = columns[i][j];
+        }
+        generic[j] = eval_poly_body(poly.body, poly.parameters, arg_values, this);
+    }
+    double generic_seconds = chrono::duration<double>(Clock::now() - start).count();
+
+    // One tuple at a time through the compiled form, first through the
+    // power slots and then through the kernel for this arity, if any.
+    vector<int> slots(count), fixed(count);
+    vector<int> tuple(arity);
+    start = Clock::now();
+    for (size_t j = 0; j < count; ++j)
+    {
+        for (size_t i = 0; i < arity; ++i)
+        {
+            tuple[i] = columns[i][j];
+        }
+        slots[j] = eval_compiled_slots(compiled, tuple.data());
+    }
+    double slots_seconds = chrono::duration<double>(Clock::now() - start).count();
+    start = Clock::now();
+    for (size_t j = 0; j < count; ++j)
+    {
+        for (size_t i = 0; i < arity; ++i)
+        {
+            tuple[i] = columns[i][j];
+        }
+        fixed[j] = eval_compiled(compiled, tuple.data());
+    }
+    double fixed_seconds = chrono::duration<double>(Clock::now() - start).count();
+
+    vector<const int *> column_ptrs;
+    for (const auto &column : columns)
+    {
+        column_ptrs.push_back(column.data());
+    }
+    start = Clock::now();
+    eval_compiled_batch(compiled, column_ptrs, count, batch.data());
+    double batch_seconds = chrono::duration<double>(Clock::now() - start).count();
+
+    output_stream << "polynomial " << poly_name << ": " << compiled.coefficients.size() << " terms, "
+                  << count << " argument tuples" << endl;
+    output_stream << "generic eval:   " << generic_seconds << " s, " << count / generic_seconds << " evals/s" << endl;
+    output_stream << "compiled slots: " << slots_seconds << " s, " << count / slots_seconds << " evals/s" << endl;
+    if (!compiled.fixed_exponents.empty())
+    {
+        output_stream << "arity " << arity << " kernel: " << fixed_seconds << " s, " << count / fixed_seconds << " evals/s" << endl;
+    }
+    else
+    {
+        output_stream << "arity " << arity << " kernel: not used (more than " << FIXED_MAX_ARITY
+                      << " parameters or an exponent above " << FIXED_MAX_EXPONENT << ")" << endl;
+    }
+    output_stream << "batch (" << batch_kernel_name() << "): " << batch_seconds << " s, " << count / batch_seconds << " evals/s" << endl;
+    bool match = generic == slots && generic == fixed && generic == batch;
+    output_stream << "results " << (match ? "match" : "DIFFER") << endl;
+}
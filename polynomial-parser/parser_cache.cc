@@ -0,0 +1,349 @@
+#include "parser.h"
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <map>
+
+using namespace std;
+
+// Serialization of a parsed and checked program for --cache-dir. The
+// payload holds the tasks and inputs, the variable locations, every
+// distinct polynomial body (children before parents, so shared bodies
+// stay shared), the polynomials in declaration order and the EXECUTE
+// statements. It is written before any optimization pass runs, so one
+// image serves every combination of flags.
+
+void Parser::use_program_cache(ProgramCache *cache, const string &path, const string &source, uint64_t source_hash)
+{
+    program_cache = cache;
+    program_cache_path = path;
+    program_source = source;
+    program_source_hash = source_hash;
+}
+
+// --- Writing ---
+
+static void number_bodies(PolyBody *body, map<PolyBody *, int> &index, vector<PolyBody *> &order)
+{
+    if (index.count(body))
+    {
+        return;
+    }
+    for (auto &term_pair : body->terms)
+    {
+        for (PolyBody *sub_body : term_pair.second->parenthesized_lists)
+        {
+            number_bodies(sub_body, index, order);
+        }
+    }
+    index[body] = order.size();
+    order.push_back(body);
+}
+
+static void put_poly_eval(CacheWriter &w, PolyEval *pe);
+
+static void put_value(CacheWriter &w, Value *v)
+{
+    w.put((int)v->type);
+    switch (v->type)
+    {
+    case NUM_TYPE:
+        w.put(v->value);
+        break;
+    case ID_TYPE:
+        w.put(v->location);
+        break;
+    case POLY_EVAL_TYPE:
+        put_poly_eval(w, v->poly_eval);
+        break;
+    }
+}
+
+static void put_poly_eval(CacheWriter &w, PolyEval *pe)
+{
+    w.put(pe->poly_name);
+    w.put((int)pe->arguments.size());
+    for (Value *arg : pe->arguments)
+    {
+        put_value(w, arg);
+    }
+}
+
+string Parser::serialize_program()
+{
+    CacheWriter w;
+    w.put(tasks);
+    w.put(inputs);
+    w.put(next_location);
+    w.put((int)location_table.size());
+    for (const auto &entry : location_table)
+    {
+        w.put(entry.first);
+        w.put(entry.second);
+    }
+
+    map<PolyBody *, int> index;
+    vector<PolyBody *> order;
+    for (const string &name : poly_order)
+    {
+        number_bodies(symbolTable.at(name).body, index, order);
+    }
+    w.put((int)order.size());
+    for (PolyBody *body : order)
+    {
+        w.put(body->id);
+        w.put((int)body->shared);
+        w.put((int)body->terms.size());
+        for (auto &term_pair : body->terms)
+        {
+            Term *term = term_pair.second;
+            w.put((int)term_pair.first);
+            w.put(term->coefficient);
+            w.put(term->monomial_power_vector);
+            w.put((int)term->parenthesized_lists.size());
+            for (PolyBody *sub_body : term->parenthesized_lists)
+            {
+                w.put(index[sub_body]);
+            }
+        }
+    }
+
+    w.put((int)poly_order.size());
+    for (const string &name : poly_order)
+    {
+        const Polynomial &poly = symbolTable.at(name);
+        w.put(poly.name);
+        w.put((int)poly.parameters.size());
+        for (const string &param : poly.parameters)
+        {
+            w.put(param);
+        }
+        w.put(poly.line_no);
+        w.put(poly.index);
+        w.put((int)poly.explicit_parameters);
+        w.put(index[poly.body]);
+    }
+
+    w.put((int)program.size());
+    for (StatementNode *stmt : program)
+    {
+        w.put((int)stmt->type);
+        w.put(stmt->location);
+        if (stmt->type == ASSIGN_STMT)
+        {
+            put_poly_eval(w, stmt->poly_eval);
+        }
+        else if (stmt->type == COPY_STMT)
+        {
+            put_value(w, stmt->value);
+        }
+    }
+    return w.str();
+}
+
+// --- Reading ---
+
+// An image can pass its checksum and still not be one this parser wrote,
+// so everything is decoded into locals and every count, index and location
+// is checked on the way. The parser only takes the program once all of it
+// has decoded.
+
+// What the statements of an image are checked against.
+struct ImageProgram
+{
+    map<string, Polynomial> polys;
+    int num_locations;
+};
+
+static PolyEval *get_poly_eval(CacheReader &r, Arena &ast, const ImageProgram &image);
+
+static Value *get_value(CacheReader &r, Arena &ast, const ImageProgram &image)
+{
+    Value *v = ast.make<Value>();
+    v->type = (ValueType)r.get_int();
+    switch (v->type)
+    {
+    case NUM_TYPE:
+        v->value = r.get_int();
+        break;
+    case ID_TYPE:
+        v->location = r.get_int();
+        if (v->location < 0 || v->location >= image.num_locations)
+        {
+            r.fail();
+        }
+        break;
+    case POLY_EVAL_TYPE:
+        v->poly_eval = get_poly_eval(r, ast, image);
+        break;
+    default:
+        r.fail();
+        break;
+    }
+    return v;
+}
+
+static PolyEval *get_poly_eval(CacheReader &r, Arena &ast, const ImageProgram &image)
+{
+    PolyEval *pe = ast.make<PolyEval>();
+    pe->poly_name = r.get_string();
+    size_t num_args = r.get_count();
+    auto poly = image.polys.find(pe->poly_name);
+    if (poly == image.polys.end() || num_args != poly->second.parameters.size())
+    {
+        r.fail();
+    }
+    for (size_t i = 0; i < num_args && !r.failed(); ++i)
+    {
+        pe->arguments.push_back(get_value(r, ast, image));
+    }
+    return pe;
+}
+
+bool Parser::load_program(const ProgramCache &cache)
+{
+    CacheReader r(cache.payload(), cache.payload_size());
+    vector<int> image_tasks = r.get_ints();
+    vector<int> image_inputs = r.get_ints();
+    ImageProgram image;
+    image.num_locations = r.get_int();
+    map<string, int> image_locations;
+    size_t num_locations = r.get_count();
+    if (image.num_locations < 0 || num_locations != (size_t)image.num_locations)
+    {
+        r.fail();
+    }
+    for (size_t i = 0; i < num_locations && !r.failed(); ++i)
+    {
+        string id = r.get_string();
+        int location = r.get_int();
+        if (location < 0 || location >= image.num_locations || !image_locations.emplace(id, location).second)
+        {
+            r.fail();
+        }
+    }
+
+    // Bodies come children first. arity holds the length of the power
+    // vectors of each body, or -1 while it has no terms.
+    vector<PolyBody *> bodies(r.get_count());
+    vector<int> arity(bodies.size(), -1);
+    vector<bool> id_taken(bodies.size(), false);
+    for (size_t i = 0; i < bodies.size() && !r.failed(); ++i)
+    {
+        PolyBody *body = ast.make<PolyBody>();
+        body->id = r.get_int();
+        body->shared = r.get_int() != 0;
+        if (body->id < -1 || body->id >= (int)bodies.size() || (body->id == -1 && body->shared) ||
+            (body->id >= 0 && id_taken[body->id]))
+        {
+            r.fail();
+            break;
+        }
+        if (body->id >= 0)
+        {
+            id_taken[body->id] = true;
+        }
+        size_t num_terms = r.get_count();
+        for (size_t t = 0; t < num_terms && !r.failed(); ++t)
+        {
+            Term *term = ast.make<Term>();
+            char op = (char)r.get_int();
+            term->coefficient = r.get_int();
+            term->monomial_power_vector = r.get_ints();
+            int term_arity = term->monomial_power_vector.size();
+            if ((op != '+' && op != '-') || (arity[i] != -1 && arity[i] != term_arity))
+            {
+                r.fail();
+            }
+            arity[i] = term_arity;
+            for (int power : term->monomial_power_vector)
+            {
+                if (power < 0)
+                {
+                    r.fail();
+                }
+            }
+            size_t num_lists = r.get_count();
+            for (size_t l = 0; l < num_lists && !r.failed(); ++l)
+            {
+                size_t sub = (size_t)r.get_int();
+                if (sub >= i || (arity[sub] != -1 && arity[sub] != term_arity))
+                {
+                    r.fail();
+                    break;
+                }
+                term->parenthesized_lists.push_back(bodies[sub]);
+            }
+            body->terms.push_back({op, term});
+        }
+        bodies[i] = body;
+    }
+
+    vector<string> image_order;
+    size_t num_polys = r.get_count();
+    for (size_t i = 0; i < num_polys && !r.failed(); ++i)
+    {
+        Polynomial poly;
+        poly.name = r.get_string();
+        size_t num_params = r.get_count();
+        for (size_t p = 0; p < num_params && !r.failed(); ++p)
+        {
+            poly.parameters.push_back(r.get_string());
+        }
+        poly.line_no = r.get_int();
+        poly.index = r.get_int();
+        poly.explicit_parameters = r.get_int() != 0;
+        size_t body = (size_t)r.get_int();
+        if (poly.name.empty() || poly.index != (int)i || body >= bodies.size() ||
+            (arity[body] != -1 && arity[body] != (int)num_params))
+        {
+            r.fail();
+            break;
+        }
+        poly.body = bodies[body];
+        image_order.push_back(poly.name);
+        if (!image.polys.emplace(poly.name, poly).second)
+        {
+            r.fail();
+        }
+    }
+
+    vector<StatementNode *> image_program;
+    size_t num_statements = r.get_count();
+    for (size_t i = 0; i < num_statements && !r.failed(); ++i)
+    {
+        StatementNode *stmt = ast.make<StatementNode>();
+        stmt->type = (StatementType)r.get_int();
+        stmt->location = r.get_int();
+        if (stmt->type < INPUT_STMT || stmt->type > COPY_STMT || stmt->location < 0 ||
+            stmt->location >= image.num_locations)
+        {
+            r.fail();
+            break;
+        }
+        if (stmt->type == ASSIGN_STMT)
+        {
+            stmt->poly_eval = get_poly_eval(r, ast, image);
+        }
+        else if (stmt->type == COPY_STMT)
+        {
+            stmt->value = get_value(r, ast, image);
+        }
+        image_program.push_back(stmt);
+    }
+
+    if (!r.ok())
+    {
+        return false;
+    }
+    tasks = move(image_tasks);
+    inputs = move(image_inputs);
+    next_location = image.num_locations;
+    mem.assign(next_location, 0);
+    location_table = move(image_locations);
+    symbolTable = move(image.polys);
+    poly_order = move(image_order);
+    program = move(image_program);
+    return true;
+}
@@ -0,0 +1,144 @@
+#include "parser.h"
+#include <vector>
+#include <map>
+#include <set>
+#include <memory>
+#include <atomic>
+#include <functional>
+
+using namespace std;
+
+// Dataflow execution of a run of assignments. Each assignment depends on
+// the earlier assignments it must follow: the last writer of every variable
+// it reads, and the last writer and every later reader of the variable it
+// writes. Assignments whose dependencies are done run on the pool, so the
+// final memory is the one the sequential order produces.
+
+// Runs with fewer body terms to evaluate than this are not worth the task
+// overhead and run in order.
+static const long long DATAFLOW_MIN_TERMS = 1024;
+
+void Parser::collect_uses(Value *v, vector<int> &uses)
+{
+    switch (v->type)
+    {
+    case NUM_TYPE:
+        break;
+    case ID_TYPE:
+        uses.push_back(v->location);
+        break;
+    case POLY_EVAL_TYPE:
+        for (Value *arg : v->poly_eval->arguments)
+        {
+            collect_uses(arg, uses);
+        }
+        break;
+    }
+}
+
+long long Parser::call_cost(Value *v)
+{
+    if (v->type != POLY_EVAL_TYPE)
+    {
+        return 0;
+    }
+    long long cost = count_terms(symbolTable.at(v->poly_eval->poly_name).body);
+    for (Value *arg : v->poly_eval->arguments)
+    {
+        cost += call_cost(arg);
+    }
+    return cost;
+}
+
+void Parser::execute_dataflow(size_t begin, size_t end)
+{
+    size_t n = end - begin;
+    vector<vector<size_t>> successors(n);
+    unique_ptr<atomic<int>[]> waiting(new atomic<int>[n]);
+    map<int, size_t> last_writer;
+    map<int, vector<size_t>> readers; // Readers since the last write
+    long long cost = 0;
+
+    for (size_t k = 0; k < n; ++k)
+    {
+        StatementNode *stmt = program[begin + k];
+        Value rhs;
+        if (stmt->type == ASSIGN_STMT)
+        {
+            rhs.type = POLY_EVAL_TYPE;
+            rhs.poly_eval = stmt->poly_eval;
+        }
+        Value &value = (stmt->type == ASSIGN_STMT) ? rhs : *stmt->value;
+        cost += call_cost(&value);
+
+        vector<int> uses;
+        collect_uses(&value, uses);
+        int def = stmt->location;
+
+        set<size_t> preds;
+        for (int use : uses)
+        {
+            if (last_writer.count(use))
+            {
+                preds.insert(last_writer[use]);
+            }
+        }
+        if (last_writer.count(def))
+        {
+            preds.insert(last_writer[def]);
+        }
+        for (size_t reader : readers[def])
+        {
+            preds.insert(reader);
+        }
+        preds.erase(k);
+
+        waiting[k] = preds.size();
+        for (size_t pred : preds)
+        {
+            successors[pred].push_back(k);
+        }
+        for (int use : uses)
+        {
+            readers[use].push_back(k);
+        }
+        last_writer[def] = k;
+        readers[def].clear();
+    }
+
+    if (cost < DATAFLOW_MIN_TERMS)
+    {
+        for (size_t k = begin; k < end; ++k)
+        {
+            execute_statement(program[k]);
+        }
+        return;
+    }
+
+    TaskGroup group(*pool);
+    function<void(size_t)> run_node = [&](size_t k) {
+        execute_statement(program[begin + k]);
+        for (size_t next : successors[k])
+        {
+            if (--waiting[next] == 0)
+            {
+                group.run([&run_node, next]() { run_node(next); });
+            }
+        }
+    };
+    // Find every root before starting any: once nodes run, other counts
+    // drop to zero and those nodes are started by their last predecessor.
+    vector<size_t> roots;
+    for (size_t k = 0; k < n; ++k)
+    {
+        if (waiting[k] == 0)
+        {
+            roots.push_back(k);
+        }
+    }
+    for (size_t k : roots)
+    {
+        group.run([&run_node, k]() { run_node(k); });
+    }
+    group.wait();
+}
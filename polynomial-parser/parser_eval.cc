@@ -4,125 +4,265 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <algorithm>
 
 using namespace std;
 
-void Parser::execute_program()
+void Parser::execute_statement(StatementNode *stmt)
 {
-    for (StatementNode *stmt : program)
+    int location = stmt->location;
+
+    switch (stmt->type)
     {
-        int location = get_location(stmt->id);
+    case INPUT_STMT:
+        if (next_input < inputs.size())
+        {
+            mem[location] = inputs[next_input];
+            next_input++;
+        }
+        else
+        {
+            // Handle case where there are not enough inputs.
+            // The spec implies we can assume enough inputs are provided.
+        }
+        break;
+    case OUTPUT_STMT:
+        output_stream << mem[location] << endl;
+        break;
+    case ASSIGN_STMT:
+        mem[location] = eval_poly(stmt->poly_eval, this);
+        break;
+    case COPY_STMT:
+        mem[location] = eval_value(stmt->value, this);
+        break;
+    }
+}
 
-        switch (stmt->type)
+void Parser::execute_program()
+{
+    // INPUT and OUTPUT statements run in order. With a thread pool, each
+    // run of assignments between them runs as a dataflow graph.
+    size_t begin = 0;
+    while (begin < program.size())
+    {
+        size_t end = begin;
+        while (end < program.size() && (program[end]->type == ASSIGN_STMT || program[end]->type == COPY_STMT))
         {
-        case INPUT_STMT:
-            if (next_input < inputs.size())
-            {
-                mem[location] = inputs[next_input];
-                next_input++;
-            }
-            else
+            end++;
+        }
+        if (end == begin)
+        {
+            execute_statement(program[begin++]);
+        }
+        else if (pool && end - begin > 1)
+        {
+            execute_dataflow(begin, end);
+            begin = end;
+        }
+        else
+        {
+            for (; begin < end; ++begin)
             {
-                // Handle case where there are not enough inputs.
-                // The spec implies we can assume enough inputs are provided.
+                execute_statement(program[begin]);
             }
-            break;
-        case OUTPUT_STMT:
-            cout << mem[location] << endl;
-            break;
-        case ASSIGN_STMT:
-            mem[location] = eval_poly(stmt->poly_eval, this);
-            break;
         }
     }
+
+    if (memo)
+    {
+        error_stream << "memo: " << memo->hits() << " hits, " << memo->misses() << " misses, "
+                     << memo->evictions() << " evictions" << endl;
+    }
 }
 
 int eval_value(Value *v, Parser *parser)
+{
+    return eval_value(v, parser, parser->mem);
+}
+
+// Evaluates v with variables read from mem instead of the parser's memory,
+// so separate runs of the program can evaluate at the same time.
+int eval_value(Value *v, Parser *parser, const std::vector<int> &mem)
 {
     switch (v->type)
     {
     case NUM_TYPE:
         return v->value;
     case ID_TYPE:
-        return parser->mem[parser->get_location(v->id)];
+        return mem[v->location];
     case POLY_EVAL_TYPE:
-        return eval_poly(v->poly_eval, parser);
+        return eval_poly(v->poly_eval, parser, mem);
     }
     return 0; // Should not happen
 }
 
-// Forward declare eval_poly_body for eval_term
-int eval_poly_body(PolyBody *body, const std::vector<std::string> &params, const std::map<std::string, int> &arg_values, Parser *parser);
+// Values of the shared bodies computed during the current call, valid
+// while their stamp matches. Each thread evaluates one call at a time.
+template <class N>
+struct SharedBodyValues
+{
+    std::vector<N> values;
+    std::vector<unsigned> stamps;
+    unsigned stamp = 0;
+};
 
-int eval_term(Term *term, const std::vector<std::string> &params, const std::map<std::string, int> &arg_values, Parser *parser)
+template <class N>
+static SharedBodyValues<N> &shared_values()
 {
-    int term_val = 1;
-    // Handle parenthesized lists product
-    for (PolyBody *pb : term->parenthesized_lists)
-    {
-        term_val *= eval_poly_body(pb, params, arg_values, parser);
-    }
+    static thread_local SharedBodyValues<N> values;
+    return values;
+}
 
-    int monomial_product = 1;
-    for (size_t i = 0; i < term->monomial_power_vector.size(); ++i)
+template <class N>
+static N eval_body_in_call(PolyBody *body, const std::vector<std::string> &params, const std::map<std::string, N> &arg_values, Parser *parser);
+
+template <class N>
+N eval_term(Term *term, const std::vector<std::string> &params, const std::map<std::string, N> &arg_values, Parser *parser)
+{
+    // Once a factor is zero the rest need not be evaluated, which also
+    // keeps the checked mode from reporting overflow in a zero term.
+    N term_val(term->coefficient);
+    for (size_t i = 0; i < term->monomial_power_vector.size() && !numeric_is_zero(term_val); ++i)
     {
         if (term->monomial_power_vector[i] > 0)
         {
-            std::string var_name = params[i];
-            int power = term->monomial_power_vector[i];
-            int base = arg_values.count(var_name) ? arg_values.at(var_name) : 0;
-            
-            // Integer exponentiation to avoid floating-point errors
-            long long term_pow = 1;
-            for(int j = 0; j < power; ++j) {
-                term_pow *= base;
-            }
-            monomial_product *= term_pow;
+            auto found = arg_values.find(params[i]);
+            N base = found != arg_values.end() ? found->second : N(0);
+            term_val = term_val * numeric_power(base, term->monomial_power_vector[i]);
         }
     }
-    term_val *= term->coefficient * monomial_product;
-
+    // Handle parenthesized lists product
+    for (size_t i = 0; i < term->parenthesized_lists.size() && !numeric_is_zero(term_val); ++i)
+    {
+        term_val = term_val * eval_body_in_call(term->parenthesized_lists[i], params, arg_values, parser);
+    }
     return term_val;
 }
 
-int eval_poly_body(PolyBody *body, const std::vector<std::string> &params, const std::map<std::string, int> &arg_values, Parser *parser)
+template <class N>
+N eval_poly_body(PolyBody *body, const std::vector<std::string> &params, const std::map<std::string, N> &arg_values, Parser *parser)
 {
-    int total = 0;
+    // A new call: forget the shared body values of the previous one.
+    SharedBodyValues<N> &shared = shared_values<N>();
+    if (++shared.stamp == 0)
+    {
+        std::fill(shared.stamps.begin(), shared.stamps.end(), 0);
+        shared.stamp = 1;
+    }
+    return eval_body_in_call(body, params, arg_values, parser);
+}
+
+template <class N>
+static N eval_body_in_call(PolyBody *body, const std::vector<std::string> &params, const std::map<std::string, N> &arg_values, Parser *parser)
+{
+    SharedBodyValues<N> &shared = shared_values<N>();
+    if (body->shared)
+    {
+        if ((size_t)body->id >= shared.stamps.size())
+        {
+            shared.stamps.resize(body->id + 1, 0);
+            shared.values.resize(body->id + 1);
+        }
+        if (shared.stamps[body->id] == shared.stamp)
+        {
+            return shared.values[body->id];
+        }
+    }
+
+    N total(0);
     for (const auto &pair : body->terms)
     {
         char op = pair.first;
         Term *term = pair.second;
-        int term_value = eval_term(term, params, arg_values, parser);
+        N term_value = eval_term(term, params, arg_values, parser);
 
         if (op == '+')
         {
-            total += term_value;
+            total = total + term_value;
         }
         else // op == '-'
         {
-            total -= term_value;
+            total = total - term_value;
         }
     }
+
+    if (body->shared)
+    {
+        shared.stamps[body->id] = shared.stamp;
+        shared.values[body->id] = total;
+    }
     return total;
 }
 
+template int eval_poly_body<int>(PolyBody *, const std::vector<std::string> &, const std::map<std::string, int> &, Parser *);
+template Checked64 eval_poly_body<Checked64>(PolyBody *, const std::vector<std::string> &, const std::map<std::string, Checked64> &, Parser *);
+template BigInt eval_poly_body<BigInt>(PolyBody *, const std::vector<std::string> &, const std::map<std::string, BigInt> &, Parser *);
+template ModInt eval_poly_body<ModInt>(PolyBody *, const std::vector<std::string> &, const std::map<std::string, ModInt> &, Parser *);
+template FingerprintInt eval_poly_body<FingerprintInt>(PolyBody *, const std::vector<std::string> &, const std::map<std::string, FingerprintInt> &, Parser *);
+
 int eval_poly(PolyEval *pe, Parser *parser)
+{
+    return eval_poly(pe, parser, parser->mem);
+}
+
+int eval_poly(PolyEval *pe, Parser *parser, const std::vector<int> &mem)
 {
     // 1. Find the polynomial declaration
     if (parser->symbolTable.count(pe->poly_name) == 0)
     {
         return 0; // Safeguard
     }
-    Polynomial poly = parser->symbolTable.at(pe->poly_name);
+    const Polynomial &poly = parser->symbolTable.at(pe->poly_name);
 
     // 2. Evaluate arguments and create a mapping from parameter name to value
+    std::vector<int> args;
     std::map<std::string, int> arg_values;
     for (size_t i = 0; i < pe->arguments.size(); ++i)
     {
         std::string param_name = poly.parameters[i];
-        arg_values[param_name] = eval_value(pe->arguments[i], parser);
+        args.push_back(eval_value(pe->arguments[i], parser, mem));
+        arg_values[param_name] = args.back();
+    }
+
+    // 3. Polynomials are pure, so a cached result for the same arguments
+    //    can stand in for evaluating the body.
+    int result;
+    if (parser->memo && parser->memo->lookup(poly.index, args, result))
+    {
+        return result;
+    }
+
+    // 4. Evaluate the polynomial body
+    result = eval_poly_body(poly.body, poly.parameters, arg_values, parser);
+    if (parser->memo)
+    {
+        parser->memo->insert(poly.index, args, result);
+    }
+    return result;
+}
+
+std::vector<int> Parser::eval_poly_batch(const Polynomial &poly, const std::vector<int> &points)
+{
+    // A univariate body is expanded once into dense coefficients and then
+    // evaluated at all points together; anything else is evaluated point
+    // by point.
+    std::vector<int> values;
+    if (poly.parameters.size() == 1 && max_degree(poly.body) <= (long long)DENSE_MAX_DEGREE)
+    {
+        DensePoly dense = expand_poly_body_dense(poly.body);
+        std::vector<uint32_t> xs(points.begin(), points.end());
+        for (uint32_t v : dense_evaluate(dense, xs))
+        {
+            values.push_back((int)v);
+        }
+        return values;
     }
 
-    // 3. Evaluate the polynomial body
-    return eval_poly_body(poly.body, poly.parameters, arg_values, parser);
+    std::map<std::string, int> arg_values;
+    for (int point : points)
+    {
+        arg_values[poly.parameters[0]] = point;
+        values.push_back(eval_poly_body(poly.body, poly.parameters, arg_values, this));
+    }
+    return values;
 }
@@ -11,14 +11,18 @@ void Parser::parse_execute_section()
 void Parser::parse_statement_list()
 {
     // statement_list -> statement | statement statement_list
-    parse_statement();
-
-    // A statement can start with INPUT, OUTPUT, or an ID.
-    // We peek ahead to see if another statement follows.
-    Token t = lexer.peek(1);
-    if (t.token_type == INPUT || t.token_type == OUTPUT || t.token_type == ID)
+    // Parsed as a loop so long programs need no stack per statement.
+    while (true)
     {
-        parse_statement_list();
+        parse_statement();
+
+        // A statement can start with INPUT, OUTPUT, or an ID.
+        // We peek ahead to see if another statement follows.
+        TokenType next = lexer.peek(1).token_type;
+        if (next != INPUT && next != OUTPUT && next != ID)
+        {
+            break;
+        }
     }
 }
 
@@ -50,10 +54,9 @@ void Parser::parse_input_statement()
     Token id_token = expect(ID);
     expect(SEMICOLON);
 
-    StatementNode *stmt = new StatementNode();
+    StatementNode *stmt = ast.make<StatementNode>();
     stmt->type = INPUT_STMT;
-    stmt->id = id_token.lexeme;
-    get_location(id_token.lexeme); // Ensure variable is allocated
+    stmt->location = get_location(id_token.lexeme);
     program.push_back(stmt);
 }
 
@@ -64,10 +67,9 @@ void Parser::parse_output_statement()
     Token id_token = expect(ID);
     expect(SEMICOLON);
 
-    StatementNode *stmt = new StatementNode();
+    StatementNode *stmt = ast.make<StatementNode>();
     stmt->type = OUTPUT_STMT;
-    stmt->id = id_token.lexeme;
-    get_location(id_token.lexeme); // Ensure variable is allocated
+    stmt->location = get_location(id_token.lexeme);
     program.push_back(stmt);
 }
 
@@ -78,11 +80,10 @@ void Parser::parse_assign_statement()
     PolyEval *poly_eval = parse_poly_evaluation();
     expect(SEMICOLON);
 
-    StatementNode *stmt = new StatementNode();
+    StatementNode *stmt = ast.make<StatementNode>();
     stmt->type = ASSIGN_STMT;
-    stmt->id = id_token.lexeme;
     stmt->poly_eval = poly_eval;
-    get_location(id_token.lexeme); // Ensure variable is allocated
+    stmt->location = get_location(id_token.lexeme);
     program.push_back(stmt);
 }
 
@@ -110,7 +111,7 @@ PolyEval *Parser::parse_poly_evaluation()
     }
     // --- END SEMANTIC CHECK ---
 
-    PolyEval *pe = new PolyEval();
+    PolyEval *pe = ast.make<PolyEval>();
     pe->poly_name = poly_name.lexeme;
     pe->arguments = args;
     return pe;
@@ -118,12 +119,10 @@ PolyEval *Parser::parse_poly_evaluation()
 void Parser::parse_argument_list(std::vector<Value *> &args)
 {
     args.push_back(parse_argument());
-
-    Token t = lexer.peek(1);
-    if (t.token_type == COMMA)
+    while (lexer.peek(1).token_type == COMMA)
     {
         expect(COMMA);
-        parse_argument_list(args); // Recurse
+        args.push_back(parse_argument());
     }
 }
 
@@ -131,7 +130,7 @@ Value *Parser::parse_argument()
 {
     // argument -> ID | NUM | poly_evaluation
     Token t = lexer.peek(1);
-    Value *val = new Value();
+    Value *val = ast.make<Value>();
 
     if (t.token_type == ID)
     {
@@ -145,8 +144,7 @@ Value *Parser::parse_argument()
         {
             Token id_token = expect(ID); // Consume the ID
             val->type = ID_TYPE;
-            val->id = id_token.lexeme;
-            get_location(id_token.lexeme); // Ensure variable is allocated
+            val->location = get_location(id_token.lexeme);
         }
     }
     else if (t.token_type == NUM)
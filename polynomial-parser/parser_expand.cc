@@ -0,0 +1,340 @@
+#include "parser.h"
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <iterator>
+#include <tuple>
+#include <type_traits>
+
+using namespace std;
+
+// The expansion engine never materializes the raw Cartesian product of a
+// term's parenthesized lists. Every factor is expanded into an Expansion,
+// the factors are multiplied pairwise in a balanced tree, and like terms are
+// folded as each product is accumulated. The size of every intermediate
+// result is therefore bounded by the number of distinct monomials, which is
+// checked against max_expanded_terms. The engine is templated on the
+// coefficient type, so the numeric modes and Task 6 share it with int.
+
+void Parser::set_max_expanded_terms(size_t limit)
+{
+    max_expanded_terms = limit;
+}
+
+void Parser::set_num_threads(unsigned num_threads)
+{
+    if (num_threads > 1)
+    {
+        pool.reset(new ThreadPool(num_threads));
+    }
+    else
+    {
+        pool.reset();
+    }
+}
+
+template <class N>
+void Parser::add_expansion(Expansion<N> &total, const Expansion<N> &m, int sign)
+{
+    for (const auto &entry : m)
+    {
+        N &coefficient = total[entry.first];
+        coefficient = sign > 0 ? coefficient + entry.second : coefficient - entry.second;
+        if (numeric_is_zero(coefficient))
+        {
+            total.erase(entry.first);
+        }
+    }
+    if (total.size() > max_expanded_terms)
+    {
+        throw ExpansionLimitExceeded{max_expanded_terms};
+    }
+}
+
+// Products with fewer term pairs than this are not worth splitting across
+// threads.
+static const size_t PARALLEL_PRODUCT_THRESHOLD = 1 << 14;
+
+template <class N>
+static void remove_zero_terms(Expansion<N> &m)
+{
+    for (auto it = m.begin(); it != m.end();)
+    {
+        if (numeric_is_zero(it->second))
+        {
+            it = m.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+template <class N>
+void Parser::multiply_range(typename Expansion<N>::const_iterator first, typename Expansion<N>::const_iterator last,
+                            const Expansion<N> &b, Expansion<N> &product)
+{
+    size_t num_params = b.begin()->first.size();
+    vector<int> powers(num_params);
+
+    for (auto t1 = first; t1 != last; ++t1)
+    {
+        for (const auto &t2 : b)
+        {
+            for (size_t i = 0; i < num_params; ++i)
+            {
+                powers[i] = t1->first[i] + t2.first[i];
+            }
+            N &coefficient = product[powers];
+            coefficient = coefficient + t1->second * t2.second;
+        }
+        // Check as we go so a runaway product stops before it fills memory.
+        if (product.size() > max_expanded_terms)
+        {
+            throw ExpansionLimitExceeded{max_expanded_terms};
+        }
+    }
+}
+
+template <class N>
+Expansion<N> Parser::multiply_expansions(const Expansion<N> &a, const Expansion<N> &b)
+{
+    Expansion<N> product;
+    if (a.empty() || b.empty())
+    {
+        return product;
+    }
+    if (pool && a.size() > 1 && a.size() * b.size() >= PARALLEL_PRODUCT_THRESHOLD)
+    {
+        return multiply_expansions_parallel(a, b);
+    }
+    multiply_range<N>(a.begin(), a.end(), b, product);
+    remove_zero_terms(product);
+    return product;
+}
+
+template <class N>
+Expansion<N> Parser::multiply_expansions_parallel(const Expansion<N> &a, const Expansion<N> &b)
+{
+    // Split the rows of a into one chunk per thread. Each chunk accumulates
+    // into its own map and the partial products are summed at the end;
+    // coefficient addition is commutative, so the result does not depend on
+    // how the chunks are scheduled.
+    size_t num_chunks = min<size_t>(pool->size(), a.size());
+    vector<typename Expansion<N>::const_iterator> bounds;
+    auto it = a.begin();
+    for (size_t c = 0; c < num_chunks; ++c)
+    {
+        bounds.push_back(it);
+        advance(it, a.size() / num_chunks + (c < a.size() % num_chunks ? 1 : 0));
+    }
+    bounds.push_back(a.end());
+
+    vector<Expansion<N>> partials(num_chunks);
+    TaskGroup group(*pool);
+    for (size_t c = 1; c < num_chunks; ++c)
+    {
+        group.run([this, c, &bounds, &b, &partials]() {
+            multiply_range<N>(bounds[c], bounds[c + 1], b, partials[c]);
+        });
+    }
+    multiply_range<N>(bounds[0], bounds[1], b, partials[0]);
+    group.wait();
+
+    Expansion<N> product = move(partials[0]);
+    for (size_t c = 1; c < num_chunks; ++c)
+    {
+        for (const auto &entry : partials[c])
+        {
+            N &coefficient = product[entry.first];
+            coefficient = coefficient + entry.second;
+        }
+        partials[c].clear();
+    }
+    remove_zero_terms(product);
+    if (product.size() > max_expanded_terms)
+    {
+        throw ExpansionLimitExceeded{max_expanded_terms};
+    }
+    return product;
+}
+
+template <class N>
+Expansion<N> Parser::expand_product(vector<Expansion<N>> &factors, size_t lo, size_t hi)
+{
+    // Multiply factors[lo, hi) in a balanced tree so that the operands of
+    // each multiplication stay similar in size. With a thread pool the two
+    // halves of every level are reduced concurrently.
+    if (hi - lo == 1)
+    {
+        return factors[lo];
+    }
+    size_t mid = lo + (hi - lo) / 2;
+    Expansion<N> left, right;
+    if (pool)
+    {
+        TaskGroup group(*pool);
+        group.run([this, &factors, &right, mid, hi]() {
+            right = expand_product(factors, mid, hi);
+        });
+        left = expand_product(factors, lo, mid);
+        group.wait();
+    }
+    else
+    {
+        left = expand_product(factors, lo, mid);
+        if (left.empty())
+        {
+            return left; // A zero factor makes the whole product zero
+        }
+        right = expand_product(factors, mid, hi);
+    }
+    return multiply_expansions(left, right);
+}
+
+template <class N>
+Expansion<N> Parser::expand_term(Term *term, const Polynomial &poly)
+{
+    // The coefficient and monomial list form the first factor, followed by
+    // one factor per parenthesized list.
+    vector<Expansion<N>> factors;
+    Expansion<N> monomial;
+    if (term->coefficient != 0)
+    {
+        monomial[term->monomial_power_vector] = N(term->coefficient);
+    }
+    factors.push_back(monomial);
+
+    for (PolyBody *sub_body : term->parenthesized_lists)
+    {
+        factors.push_back(expand_poly_body<N>(sub_body, poly));
+    }
+    return expand_product(factors, 0, factors.size());
+}
+
+template <class N>
+Expansion<N> Parser::expand_poly_body(PolyBody *body, const Polynomial &poly)
+{
+    SharedExpansions<N> &shared = get<SharedExpansions<N>>(shared_expansions);
+    if (body->shared)
+    {
+        auto found = shared.find(body);
+        if (found != shared.end())
+        {
+            return found->second;
+        }
+    }
+
+    Expansion<N> expanded;
+    for (auto &term_pair : body->terms)
+    {
+        int sign = (term_pair.first == '+') ? 1 : -1;
+        add_expansion(expanded, expand_term<N>(term_pair.second, poly), sign);
+    }
+    if (body->shared)
+    {
+        shared[body] = expanded;
+    }
+    return expanded;
+}
+
+// --- Dense univariate expansion ---
+
+long long Parser::max_degree(PolyBody *body)
+{
+    // Upper bound on the degree of a univariate body, used to decide
+    // whether the dense representation is affordable.
+    long long degree = 0;
+    for (auto &term_pair : body->terms)
+    {
+        Term *term = term_pair.second;
+        long long term_degree = term->monomial_power_vector.empty() ? 0 : term->monomial_power_vector[0];
+        for (PolyBody *sub_body : term->parenthesized_lists)
+        {
+            term_degree += max_degree(sub_body);
+        }
+        degree = max(degree, term_degree);
+    }
+    return degree;
+}
+
+DensePoly Parser::expand_term_dense(Term *term)
+{
+    vector<DensePoly> factors;
+    DensePoly monomial(term->monomial_power_vector[0] + 1, 0);
+    monomial.back() = (uint32_t)term->coefficient;
+    dense_trim(monomial);
+    factors.push_back(monomial);
+
+    for (PolyBody *sub_body : term->parenthesized_lists)
+    {
+        factors.push_back(expand_poly_body_dense(sub_body));
+    }
+    return dense_product(factors, 0, factors.size());
+}
+
+DensePoly Parser::expand_poly_body_dense(PolyBody *body)
+{
+    if (body->shared)
+    {
+        auto found = shared_dense_expansions.find(body);
+        if (found != shared_dense_expansions.end())
+        {
+            return found->second;
+        }
+    }
+
+    DensePoly expanded;
+    for (auto &term_pair : body->terms)
+    {
+        int sign = (term_pair.first == '+') ? 1 : -1;
+        dense_add(expanded, expand_term_dense(term_pair.second), sign);
+    }
+    if (body->shared)
+    {
+        shared_dense_expansions[body] = expanded;
+    }
+    return expanded;
+}
+
+template <class N>
+Expansion<N> Parser::expand_polynomial(const Polynomial &poly)
+{
+    // Shared bodies are expanded once per polynomial.
+    get<SharedExpansions<N>>(shared_expansions).clear();
+
+    // Univariate bodies whose degree fits the budget are expanded as dense
+    // coefficient arrays, where products use Karatsuba or NTT multiplication.
+    // Their coefficients wrap mod 2^32, so only int expansions take this
+    // path. Everything else goes through the sparse engine.
+    if constexpr (is_same<N, int>::value)
+    {
+        shared_dense_expansions.clear();
+        if (poly.parameters.size() == 1)
+        {
+            long long degree = max_degree(poly.body);
+            if (degree <= (long long)DENSE_MAX_DEGREE && (size_t)degree < max_expanded_terms)
+            {
+                DensePoly dense = expand_poly_body_dense(poly.body);
+                MonomialMap expanded;
+                for (size_t i = 0; i < dense.size(); ++i)
+                {
+                    if (dense[i] != 0)
+                    {
+                        expanded[vector<int>(1, (int)i)] = (int)dense[i];
+                    }
+                }
+                return expanded;
+            }
+        }
+    }
+    return expand_poly_body<N>(poly.body, poly);
+}
+
+template MonomialMap Parser::multiply_expansions<int>(const MonomialMap &, const MonomialMap &);
+template void Parser::add_expansion<int>(MonomialMap &, const MonomialMap &, int);
+template MonomialMap Parser::expand_polynomial<int>(const Polynomial &);
+template Expansion<Checked64> Parser::expand_polynomial<Checked64>(const Polynomial &);
+template Expansion<BigInt> Parser::expand_polynomial<BigInt>(const Polynomial &);
+template Expansion<ModInt> Parser::expand_polynomial<ModInt>(const Polynomial &);
@@ -0,0 +1,200 @@
+#include "parser.h"
+#include <iostream>
+#include <random>
+#include <vector>
+#include <string>
+#include <map>
+#include <set>
+#include <mutex>
+
+using namespace std;
+
+// Task 6 reports which declared polynomials are identically zero and which
+// are equal to each other, comparing parameters by position. Bodies whose
+// expansion is predicted to be small are expanded exactly; the others are
+// compared by Schwartz-Zippel fingerprints: their values at random points
+// of Z_p. Two different polynomials of total degree at most d agree at a
+// random point with probability at most d/p, so with p = 2^61 - 1 and
+// several points a false identity is out of reach for any degree the
+// parser can represent.
+//
+// An expansion indexes a repeated parameter name by its first position,
+// while a call binds the name to its last argument. Expansions are
+// therefore only compared when neither polynomial repeats a name.
+
+static const uint64_t IDENTITY_PRIME = (1ULL << 61) - 1;
+static const int IDENTITY_POINTS = 4;
+static const size_t IDENTITY_EXPAND_TERMS = 256;
+
+// Upper bound on the number of terms in the expansion of a body, saturating
+// just above limit.
+static size_t predicted_terms(PolyBody *body, size_t limit)
+{
+    size_t total = 0;
+    for (auto &term_pair : body->terms)
+    {
+        size_t product = 1;
+        for (PolyBody *sub_body : term_pair.second->parenthesized_lists)
+        {
+            product *= predicted_terms(sub_body, limit);
+            if (product > limit)
+            {
+                return limit + 1;
+            }
+        }
+        total += product;
+        if (total > limit)
+        {
+            return limit + 1;
+        }
+    }
+    return total;
+}
+
+struct IdentityKey
+{
+    size_t arity;
+    bool expanded; // exact holds the full expansion
+    bool distinct; // No parameter name repeats, so exact is indexed by argument position
+    map<vector<int>, BigInt> exact;
+    vector<FingerprintInt> fingerprint;
+};
+
+static bool is_zero_polynomial(const IdentityKey &key)
+{
+    if (key.expanded)
+    {
+        return key.exact.empty();
+    }
+    for (const FingerprintInt &value : key.fingerprint)
+    {
+        if (!value.is_zero())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool same_polynomial(const IdentityKey &a, const IdentityKey &b)
+{
+    if (a.arity != b.arity)
+    {
+        return false;
+    }
+    if (a.expanded && b.expanded && a.distinct && b.distinct)
+    {
+        if (a.exact.size() != b.exact.size())
+        {
+            return false;
+        }
+        for (auto ia = a.exact.begin(), ib = b.exact.begin(); ia != a.exact.end(); ++ia, ++ib)
+        {
+            if (ia->first != ib->first || !(ia->second - ib->second).is_zero())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+    for (size_t i = 0; i < a.fingerprint.size(); ++i)
+    {
+        if (!(a.fingerprint[i] - b.fingerprint[i]).is_zero())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Parser::print_identities()
+{
+    static once_flag field_ready;
+    call_once(field_ready, []() { FingerprintInt::set_modulus(IDENTITY_PRIME); });
+
+    // Every polynomial of the same arity is evaluated at the same points,
+    // drawn from a fixed seed so the report is reproducible.
+    mt19937_64 rng(IDENTITY_PRIME);
+    map<size_t, vector<vector<FingerprintInt>>> points;
+    vector<IdentityKey> keys(poly_order.size());
+    // Exact expansions run in the Task 5 engine with the budget narrowed
+    // to IDENTITY_EXPAND_TERMS.
+    size_t task5_limit = max_expanded_terms;
+    max_expanded_terms = IDENTITY_EXPAND_TERMS;
+    for (size_t i = 0; i < poly_order.size(); ++i)
+    {
+        const Polynomial &poly = symbolTable.at(poly_order[i]);
+        IdentityKey &key = keys[i];
+        key.arity = poly.parameters.size();
+        key.distinct = set<string>(poly.parameters.begin(), poly.parameters.end()).size() == key.arity;
+
+        vector<vector<FingerprintInt>> &arity_points = points[key.arity];
+        if (arity_points.empty())
+        {
+            for (int k = 0; k < IDENTITY_POINTS; ++k)
+            {
+                vector<FingerprintInt> point;
+                for (size_t j = 0; j < key.arity; ++j)
+                {
+                    point.push_back(FingerprintInt((long long)(rng() >> 3)));
+                }
+                arity_points.push_back(point);
+            }
+        }
+        for (const vector<FingerprintInt> &point : arity_points)
+        {
+            map<string, FingerprintInt> arg_values;
+            for (size_t j = 0; j < key.arity; ++j)
+            {
+                arg_values[poly.parameters[j]] = point[j];
+            }
+            key.fingerprint.push_back(eval_poly_body(poly.body, poly.parameters, arg_values, this));
+        }
+
+        key.expanded = false;
+        if (predicted_terms(poly.body, IDENTITY_EXPAND_TERMS) <= IDENTITY_EXPAND_TERMS)
+        {
+            try
+            {
+                key.exact = expand_polynomial<BigInt>(poly);
+                key.expanded = true;
+            }
+            catch (const ExpansionLimitExceeded &e)
+            {
+            }
+        }
+    }
+    max_expanded_terms = task5_limit;
+
+    // Group the polynomials into classes, each led by its first declared
+    // member, and print the classes that state an identity.
+    vector<bool> grouped(keys.size(), false);
+    output_stream << "POLY - IDENTITIES" << endl;
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        if (grouped[i])
+        {
+            continue;
+        }
+        string line = "    " + poly_order[i];
+        bool identity = false;
+        for (size_t j = i + 1; j < keys.size(); ++j)
+        {
+            if (!grouped[j] && same_polynomial(keys[i], keys[j]))
+            {
+                grouped[j] = true;
+                line += " = " + poly_order[j];
+                identity = true;
+            }
+        }
+        if (is_zero_polynomial(keys[i]))
+        {
+            line += " = 0";
+            identity = true;
+        }
+        if (identity)
+        {
+            output_stream << line << " ;" << endl;
+        }
+    }
+}
@@ -0,0 +1,508 @@
+#include "parser.h"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <random>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+
+// Native code: the checked and optimized program is emitted as one C++
+// translation unit, built with the system compiler and loaded with dlopen.
+// Each polynomial becomes an inline function, in Horner form when it
+// expands within NATIVE_EXPAND_TERMS terms and over its body tree
+// otherwise, and the EXECUTE section becomes straight-line code over the
+// memory locations. All arithmetic is on uint32_t, which wraps as the int
+// evaluator does. Objects are cached under a hash of the generated source,
+// and a new object enters the cache only after its polynomials and runs
+// agree with the interpreter.
+
+static const size_t NATIVE_EXPAND_TERMS = 4096;
+
+// Statements per generated function. One function per section would be
+// simplest, but compilers slow down badly on very long functions.
+static const size_t NATIVE_PART_STATEMENTS = 256;
+
+// Random argument tuples and INPUTS lists tried by the differential check.
+static const int NATIVE_CHECK_POINTS = 16;
+static const int NATIVE_CHECK_RUNS = 4;
+
+void Parser::enable_native(const string &dir)
+{
+    native_mode = true;
+    native_dir = dir;
+}
+
+// --- Emission ---
+
+static string native_literal(uint32_t value)
+{
+    return to_string(value) + "u";
+}
+
+static string native_power(const string &var, int exp)
+{
+    return exp == 1 ? var : "pw(" + var + ", " + to_string(exp) + ")";
+}
+
+// expr * factor, leaving out a factor of one and needless parentheses.
+static string native_times(const string &expr, const string &factor)
+{
+    if (expr == "1u")
+    {
+        return factor;
+    }
+    bool sum = expr.find(" + ") != string::npos || expr.find(" - ") != string::npos;
+    return (sum ? "(" + expr + ")" : expr) + " * " + factor;
+}
+
+typedef vector<const MonomialMap::value_type *> NativeTerms;
+
+// Horner form in the variables from var on: the terms are grouped by the
+// exponent of var, highest first, and each step multiplies by the gap to
+// the next exponent down.
+static string native_horner(const NativeTerms &terms, size_t var, const vector<string> &vars)
+{
+    if (var == vars.size())
+    {
+        return native_literal((uint32_t)terms[0]->second);
+    }
+    map<int, NativeTerms, greater<int>> by_exp;
+    for (const MonomialMap::value_type *term : terms)
+    {
+        by_exp[var < term->first.size() ? term->first[var] : 0].push_back(term);
+    }
+
+    string horner;
+    int prev = -1;
+    for (const auto &group : by_exp)
+    {
+        string inner = native_horner(group.second, var + 1, vars);
+        if (prev < 0)
+        {
+            horner = inner;
+        }
+        else
+        {
+            horner = native_times(horner, native_power(vars[var], prev - group.first)) + " + " + inner;
+        }
+        prev = group.first;
+    }
+    if (prev > 0)
+    {
+        horner = native_times(horner, native_power(vars[var], prev));
+    }
+    return horner;
+}
+
+// Declares a local for every body reachable from body, children first.
+static void emit_native_body(PolyBody *body, const vector<string> &vars, map<PolyBody *, string> &locals,
+                             ostringstream &out)
+{
+    if (locals.count(body))
+    {
+        return;
+    }
+    for (auto &term_pair : body->terms)
+    {
+        for (PolyBody *sub_body : term_pair.second->parenthesized_lists)
+        {
+            emit_native_body(sub_body, vars, locals, out);
+        }
+    }
+
+    string expr;
+    for (auto &term_pair : body->terms)
+    {
+        Term *term = term_pair.second;
+        string product = native_literal((uint32_t)term->coefficient);
+        for (size_t i = 0; i < term->monomial_power_vector.size(); ++i)
+        {
+            if (term->monomial_power_vector[i] > 0)
+            {
+                product = native_times(product, native_power(vars[i], term->monomial_power_vector[i]));
+            }
+        }
+        for (PolyBody *sub_body : term_pair.second->parenthesized_lists)
+        {
+            product = native_times(product, locals[sub_body]);
+        }
+        if (expr.empty())
+        {
+            expr = (term_pair.first == '-') ? "0u - " + product : product;
+        }
+        else
+        {
+            expr += (term_pair.first == '-') ? " - " : " + ";
+            expr += product;
+        }
+    }
+    string name = "b" + to_string(locals.size());
+    locals[body] = name;
+    out << "    const u32 " << name << " = " << (expr.empty() ? "0u" : expr) << ";\n";
+}
+
+void Parser::emit_native_poly(const Polynomial &poly, int index, ostringstream &out)
+{
+    vector<string> vars;
+    for (size_t i = 0; i < poly.parameters.size(); ++i)
+    {
+        vars.push_back("a" + to_string(i));
+    }
+    out << "// " << poly.name << "(";
+    for (size_t i = 0; i < poly.parameters.size(); ++i)
+    {
+        out << (i ? ", " : "") << poly.parameters[i];
+    }
+    out << ")\n";
+    out << "static inline u32 p" << index << "(";
+    for (size_t i = 0; i < vars.size(); ++i)
+    {
+        out << (i ? ", " : "") << "u32 " << vars[i];
+    }
+    out << ")\n{\n";
+
+    // A repeated parameter name takes its last argument, as in the tree
+    // evaluator. Such polynomials keep the tree form.
+    set<string> distinct(poly.parameters.begin(), poly.parameters.end());
+    for (size_t i = 0; i < poly.parameters.size(); ++i)
+    {
+        for (size_t j = i + 1; j < poly.parameters.size(); ++j)
+        {
+            if (poly.parameters[j] == poly.parameters[i])
+            {
+                vars[i] = vars[j];
+            }
+        }
+    }
+
+    bool expanded = false;
+    if (distinct.size() == poly.parameters.size())
+    {
+        size_t saved_limit = max_expanded_terms;
+        max_expanded_terms = min(max_expanded_terms, NATIVE_EXPAND_TERMS);
+        try
+        {
+            MonomialMap terms = expand_polynomial(poly);
+            NativeTerms term_list;
+            for (const auto &term : terms)
+            {
+                term_list.push_back(&term);
+            }
+            out << "    return " << (term_list.empty() ? "0u" : native_horner(term_list, 0, vars)) << ";\n";
+            expanded = true;
+        }
+        catch (const ExpansionLimitExceeded &e)
+        {
+        }
+        max_expanded_terms = saved_limit;
+    }
+    if (!expanded)
+    {
+        map<PolyBody *, string> locals;
+        emit_native_body(poly.body, vars, locals, out);
+        out << "    return " << locals[poly.body] << ";\n";
+    }
+    out << "}\n\n";
+}
+
+string Parser::emit_native_value(Value *v, const map<string, int> &functions)
+{
+    switch (v->type)
+    {
+    case NUM_TYPE:
+        return native_literal((uint32_t)v->value);
+    case ID_TYPE:
+        return "m[" + to_string(v->location) + "]";
+    case POLY_EVAL_TYPE:
+        break;
+    }
+    PolyEval *pe = v->poly_eval;
+    string call = "p" + to_string(functions.at(pe->poly_name)) + "(";
+    for (size_t i = 0; i < pe->arguments.size(); ++i)
+    {
+        call += (i ? ", " : "") + emit_native_value(pe->arguments[i], functions);
+    }
+    return call + ")";
+}
+
+string Parser::emit_native_source()
+{
+    // Declared polynomials first, so their index is their declaration
+    // index, then the ones made by specialization.
+    map<string, int> functions;
+    vector<const Polynomial *> polys;
+    for (const string &name : poly_order)
+    {
+        functions[name] = polys.size();
+        polys.push_back(&symbolTable.at(name));
+    }
+    for (const auto &entry : symbolTable)
+    {
+        if (functions.count(entry.first) == 0)
+        {
+            functions[entry.first] = polys.size();
+            polys.push_back(&entry.second);
+        }
+    }
+
+    ostringstream out;
+    out << "// Generated by polynomial-parser --native.\n"
+           "#include <cstddef>\n"
+           "#include <cstdint>\n\n"
+           "typedef uint32_t u32;\n\n"
+           "static inline u32 pw(u32 x, unsigned e)\n"
+           "{\n"
+           "    u32 r = 1;\n"
+           "    for (; e; e >>= 1, x *= x)\n"
+           "    {\n"
+           "        if (e & 1)\n"
+           "        {\n"
+           "            r *= x;\n"
+           "        }\n"
+           "    }\n"
+           "    return r;\n"
+           "}\n\n";
+    for (size_t k = 0; k < polys.size(); ++k)
+    {
+        emit_native_poly(*polys[k], k, out);
+    }
+
+    // Entry points of the declared polynomials, for the differential check.
+    for (size_t k = 0; k < poly_order.size(); ++k)
+    {
+        out << "extern \"C\" int32_t pp_poly_" << k << "(const int32_t *a)\n{\n    return (int32_t)p" << k << "(";
+        for (size_t i = 0; i < polys[k]->parameters.size(); ++i)
+        {
+            out << (i ? ", " : "") << "(u32)a[" << i << "]";
+        }
+        out << ");\n}\n\n";
+    }
+    out << "extern \"C\" const size_t pp_num_polys = " << poly_order.size() << ";\n";
+    out << "extern \"C\" int32_t (*const pp_polys[])(const int32_t *) = {";
+    for (size_t k = 0; k < poly_order.size(); ++k)
+    {
+        out << (k ? ", " : "") << "pp_poly_" << k;
+    }
+    out << (poly_order.empty() ? "nullptr" : "") << "};\n\n";
+
+    out << "struct Run\n"
+           "{\n"
+           "    const int32_t *inputs;\n"
+           "    size_t num_inputs;\n"
+           "    size_t next_input;\n"
+           "    u32 *m;\n"
+           "    int32_t *outputs;\n"
+           "    size_t num_outputs;\n"
+           "};\n\n";
+    size_t num_parts = (program.size() + NATIVE_PART_STATEMENTS - 1) / NATIVE_PART_STATEMENTS;
+    for (size_t part = 0; part < num_parts; ++part)
+    {
+        out << "__attribute__((noinline)) static void part" << part << "(Run &r)\n{\n    u32 *m = r.m;\n";
+        size_t last = min(program.size(), (part + 1) * NATIVE_PART_STATEMENTS);
+        for (size_t s = part * NATIVE_PART_STATEMENTS; s < last; ++s)
+        {
+            StatementNode *stmt = program[s];
+            string location = "m[" + to_string(stmt->location) + "]";
+            switch (stmt->type)
+            {
+            case INPUT_STMT:
+                out << "    if (r.next_input < r.num_inputs)\n    {\n        " << location
+                    << " = (u32)r.inputs[r.next_input++];\n    }\n";
+                break;
+            case OUTPUT_STMT:
+                out << "    r.outputs[r.num_outputs++] = (int32_t)" << location << ";\n";
+                break;
+            case ASSIGN_STMT:
+            {
+                Value call;
+                call.type = POLY_EVAL_TYPE;
+                call.poly_eval = stmt->poly_eval;
+                out << "    " << location << " = " << emit_native_value(&call, functions) << ";\n";
+                break;
+            }
+            case COPY_STMT:
+                out << "    " << location << " = " << emit_native_value(stmt->value, functions) << ";\n";
+                break;
+            }
+        }
+        out << "}\n\n";
+    }
+
+    size_t num_outputs = 0;
+    for (StatementNode *stmt : program)
+    {
+        num_outputs += (stmt->type == OUTPUT_STMT);
+    }
+    out << "extern \"C\" const size_t pp_num_locations = " << mem.size() << ";\n";
+    out << "extern \"C\" const size_t pp_num_outputs = " << num_outputs << ";\n\n";
+    out << "extern \"C\" size_t pp_execute(const int32_t *inputs, size_t num_inputs, u32 *m, int32_t *outputs)\n"
+           "{\n"
+           "    Run r = {inputs, num_inputs, 0, m, outputs, 0};\n";
+    for (size_t part = 0; part < num_parts; ++part)
+    {
+        out << "    part" << part << "(r);\n";
+    }
+    out << "    return r.num_outputs;\n}\n";
+    return out.str();
+}
+
+// --- Loading ---
+
+bool Parser::bind_native()
+{
+    const size_t *num_polys = (const size_t *)native_module.symbol("pp_num_polys");
+    const size_t *num_locations = (const size_t *)native_module.symbol("pp_num_locations");
+    const size_t *num_outputs = (const size_t *)native_module.symbol("pp_num_outputs");
+    native_polys = (const NativePoly *)native_module.symbol("pp_polys");
+    native_execute = (NativeExecute)native_module.symbol("pp_execute");
+    if (!num_polys || !num_locations || !num_outputs || !native_polys || !native_execute ||
+        *num_polys != poly_order.size() || *num_locations != mem.size())
+    {
+        native_execute = nullptr;
+        return false;
+    }
+    native_outputs = *num_outputs;
+    return true;
+}
+
+// Runs every declared polynomial on fixed and random argument tuples, and
+// the EXECUTE section on the INPUTS and on random ones, natively and in
+// the interpreter. Reports the first difference.
+bool Parser::check_native()
+{
+    mt19937 rng(20240601);
+    uniform_int_distribution<int> any(INT_MIN, INT_MAX);
+    uniform_int_distribution<int> small(-16, 16);
+    vector<int> args;
+    map<string, int> arg_values;
+    for (size_t k = 0; k < poly_order.size(); ++k)
+    {
+        const Polynomial &poly = symbolTable.at(poly_order[k]);
+        for (int point = 0; point < NATIVE_CHECK_POINTS; ++point)
+        {
+            args.assign(poly.parameters.size(), 0);
+            for (int &arg : args)
+            {
+                arg = (point == 0) ? 0 : (point == 1) ? 1 : (point == 2) ? -1 : (point % 2) ? small(rng) : any(rng);
+            }
+            for (size_t i = 0; i < args.size(); ++i)
+            {
+                arg_values[poly.parameters[i]] = args[i];
+            }
+            int expected = eval_poly_body(poly.body, poly.parameters, arg_values, this);
+            int actual = native_polys[k](args.data());
+            arg_values.clear();
+            if (actual != expected)
+            {
+                error_stream << "native: " << poly.name << " gives " << actual << " instead of " << expected
+                             << " at (";
+                for (size_t i = 0; i < args.size(); ++i)
+                {
+                    error_stream << (i ? ", " : "") << args[i];
+                }
+                error_stream << ")" << endl;
+                return false;
+            }
+        }
+    }
+
+    size_t num_input_stmts = 0;
+    for (StatementNode *stmt : program)
+    {
+        num_input_stmts += (stmt->type == INPUT_STMT);
+    }
+    vector<int> batch = inputs;
+    for (int run = 0; run <= NATIVE_CHECK_RUNS; ++run)
+    {
+        if (run > 0)
+        {
+            batch.assign(num_input_stmts, 0);
+            for (int &value : batch)
+            {
+                value = (run % 2) ? small(rng) : any(rng);
+            }
+        }
+        string expected;
+        string actual;
+        run_batch(batch, expected);
+        run_native(batch, actual);
+        if (actual != expected)
+        {
+            error_stream << "native: the EXECUTE section differs from the interpreter on "
+                         << (run == 0 ? "the INPUTS" : "random INPUTS") << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Loads the object for this program from the native cache, or builds,
+// checks and caches it. Returns whether native_execute can be used.
+bool Parser::prepare_native()
+{
+    if (native_ready)
+    {
+        return true;
+    }
+    string error;
+    if (!NativeModule::prepare_dir(native_dir, error))
+    {
+        error_stream << "native: " << error;
+        return false;
+    }
+    string source = emit_native_source();
+    string path = NativeModule::path_for(native_dir, ProgramCache::hash_source(source));
+    if (native_module.open(path))
+    {
+        if (bind_native())
+        {
+            native_ready = true;
+            return true;
+        }
+        native_module.close();
+    }
+
+    string temp_path, log;
+    if (!NativeModule::compile(source, path, temp_path, log))
+    {
+        error_stream << "native: cannot compile " << path.substr(0, path.size() - 3) << ".cc" << endl << log;
+        return false;
+    }
+    bool loaded = native_module.open(temp_path) && bind_native();
+    if (!loaded)
+    {
+        error_stream << "native: cannot load " << temp_path << endl;
+    }
+    if (!loaded || !check_native())
+    {
+        native_execute = nullptr;
+        native_module.close();
+        remove(temp_path.c_str());
+        return false;
+    }
+    if (rename(temp_path.c_str(), path.c_str()) != 0)
+    {
+        remove(temp_path.c_str());
+    }
+    error_stream << "native: built " << path << endl;
+    native_ready = true;
+    return true;
+}
+
+void Parser::run_native(const vector<int> &batch, string &out)
+{
+    vector<uint32_t> native_mem(mem.size(), 0);
+    vector<int32_t> outputs(native_outputs);
+    size_t count = native_execute(batch.data(), batch.size(), native_mem.data(), outputs.data());
+    for (size_t i = 0; i < count; ++i)
+    {
+        out += to_string(outputs[i]);
+        out += '\n';
+    }
+}
@@ -0,0 +1,156 @@
+#include "parser.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <map>
+
+using namespace std;
+
+// Task 2 and Task 5 in the numeric modes other than plain int. Programs
+// run here with values of the mode's number type; polynomial calls and
+// expansions go through the same templated evaluator and expansion engine
+// as int, instantiated once per mode by the dispatch functions at the
+// bottom of the file.
+
+// --- Evaluation ---
+
+template <class N>
+N Parser::eval_value_as(Value *v, const vector<N> &values)
+{
+    switch (v->type)
+    {
+    case NUM_TYPE:
+        return N(v->value);
+    case ID_TYPE:
+        return values[v->location];
+    case POLY_EVAL_TYPE:
+        return eval_poly_as(v->poly_eval, values);
+    }
+    return N(0);
+}
+
+template <class N>
+N Parser::eval_poly_as(PolyEval *pe, const vector<N> &values)
+{
+    const Polynomial &poly = symbolTable.at(pe->poly_name);
+    // A repeated parameter name takes the last argument given for it.
+    map<string, N> arg_values;
+    for (size_t i = 0; i < pe->arguments.size(); ++i)
+    {
+        arg_values[poly.parameters[i]] = eval_value_as(pe->arguments[i], values);
+    }
+    return eval_poly_body(poly.body, poly.parameters, arg_values, this);
+}
+
+// --- Execution ---
+
+template <class N>
+void Parser::run_batch_as(const vector<int> &batch, string &out)
+{
+    vector<N> values(mem.size());
+    size_t next = 0;
+    try
+    {
+        for (StatementNode *stmt : program)
+        {
+            switch (stmt->type)
+            {
+            case INPUT_STMT:
+                if (next < batch.size())
+                {
+                    values[stmt->location] = N(batch[next++]);
+                }
+                break;
+            case OUTPUT_STMT:
+                out += values[stmt->location].str();
+                out += '\n';
+                break;
+            case ASSIGN_STMT:
+                values[stmt->location] = eval_poly_as(stmt->poly_eval, values);
+                break;
+            case COPY_STMT:
+                values[stmt->location] = eval_value_as(stmt->value, values);
+                break;
+            }
+        }
+    }
+    catch (const NumericOverflow &e)
+    {
+        out += "NUMERIC OVERFLOW\n";
+    }
+}
+
+// --- Expansion ---
+
+template <class N>
+void Parser::print_expansion_as(const Polynomial &poly)
+{
+    Expansion<N> expanded;
+    try
+    {
+        expanded = expand_polynomial<N>(poly);
+    }
+    catch (const ExpansionLimitExceeded &e)
+    {
+        output_stream << "EXPANSION LIMIT EXCEEDED (more than " << e.limit << " terms) ;" << endl;
+        return;
+    }
+    catch (const NumericOverflow &e)
+    {
+        output_stream << "NUMERIC OVERFLOW ;" << endl;
+        return;
+    }
+    print_expanded_terms(expanded, poly);
+}
+
+// --- Dispatch ---
+
+void Parser::set_numeric_mode(NumericMode mode)
+{
+    numeric_mode = mode;
+}
+
+void Parser::run_batch_numeric(const vector<int> &batch, string &out)
+{
+    switch (numeric_mode)
+    {
+    case NUMERIC_CHECKED64:
+        run_batch_as<Checked64>(batch, out);
+        break;
+    case NUMERIC_BIGINT:
+        run_batch_as<BigInt>(batch, out);
+        break;
+    case NUMERIC_MODULAR:
+        run_batch_as<ModInt>(batch, out);
+        break;
+    default:
+        run_batch(batch, out);
+        break;
+    }
+}
+
+void Parser::execute_numeric()
+{
+    string out;
+    run_batch_numeric(inputs, out);
+    output_stream << out;
+    output_stream.flush();
+}
+
+void Parser::print_poly_task5_numeric(const Polynomial &poly)
+{
+    switch (numeric_mode)
+    {
+    case NUMERIC_CHECKED64:
+        print_expansion_as<Checked64>(poly);
+        break;
+    case NUMERIC_BIGINT:
+        print_expansion_as<BigInt>(poly);
+        break;
+    case NUMERIC_MODULAR:
+        print_expansion_as<ModInt>(poly);
+        break;
+    default:
+        break;
+    }
+}
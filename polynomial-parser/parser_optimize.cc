@@ -0,0 +1,479 @@
+#include "parser.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+
+using namespace std;
+
+// Passes that rewrite the EXECUTE IR in place before it runs. Every pass
+// keeps the output of the program exactly as the interpreter produces it.
+
+// Term budget for the expanded body of a specialized polynomial.
+static const size_t SPECIALIZE_MAX_TERMS = 4096;
+
+void Parser::enable_optimizations(int flags)
+{
+    optimizations |= flags;
+}
+
+void Parser::optimize_program()
+{
+    // Folding evaluates calls with the wrapping int arithmetic, so it only
+    // applies in that numeric mode.
+    if ((optimizations & OPT_FOLD) && numeric_mode == NUMERIC_INT32)
+    {
+        fold_constants();
+    }
+    if (optimizations & OPT_DCE)
+    {
+        eliminate_dead_statements();
+    }
+    if (optimizations & OPT_CSE)
+    {
+        eliminate_common_subexpressions();
+    }
+}
+
+// --- Constant folding and specialization ---
+
+int count_terms(PolyBody *body)
+{
+    int count = 0;
+    for (auto &term_pair : body->terms)
+    {
+        count++;
+        for (PolyBody *sub_body : term_pair.second->parenthesized_lists)
+        {
+            count += count_terms(sub_body);
+        }
+    }
+    return count;
+}
+
+static PolyBody *body_from_monomials(Arena &ast, const MonomialMap &expanded, size_t num_params)
+{
+    PolyBody *body = ast.make<PolyBody>();
+    for (const auto &entry : expanded)
+    {
+        Term *term = ast.make<Term>();
+        term->coefficient = entry.second;
+        term->monomial_power_vector = entry.first;
+        body->terms.push_back({'+', term});
+    }
+    if (body->terms.empty())
+    {
+        Term *zero = ast.make<Term>();
+        zero->coefficient = 0;
+        zero->monomial_power_vector.resize(num_params, 0);
+        body->terms.push_back({'+', zero});
+    }
+    return body;
+}
+
+bool Parser::specialize_call(PolyEval *pe)
+{
+    // The specialized polynomial is named after the call pattern, e.g.
+    // F[2,_] for F(2, y). Brackets cannot appear in an ID, so the name never
+    // clashes with a declared polynomial.
+    const Polynomial &poly = symbolTable.at(pe->poly_name);
+    string key = pe->poly_name + "[";
+    vector<Value *> remaining;
+    for (size_t i = 0; i < pe->arguments.size(); ++i)
+    {
+        Value *arg = pe->arguments[i];
+        key += (i > 0 ? "," : "");
+        if (arg->type == NUM_TYPE)
+        {
+            key += to_string(arg->value);
+        }
+        else
+        {
+            key += "_";
+            remaining.push_back(arg);
+        }
+    }
+    key += "]";
+
+    if (unspecializable.count(key))
+    {
+        return false;
+    }
+    if (symbolTable.count(key) == 0)
+    {
+        Polynomial spec;
+        spec.name = key;
+        spec.line_no = poly.line_no;
+        spec.explicit_parameters = true;
+        spec.index = symbolTable.size();
+
+        begin_symbolic(remaining.size(), SPECIALIZE_MAX_TERMS);
+        vector<MonomialMap> args;
+        for (size_t i = 0; i < pe->arguments.size(); ++i)
+        {
+            if (pe->arguments[i]->type == NUM_TYPE)
+            {
+                args.push_back(symbolic_constant(pe->arguments[i]->value));
+            }
+            else
+            {
+                vector<int> powers(remaining.size(), 0);
+                powers[spec.parameters.size()] = 1;
+                args.push_back(MonomialMap{{powers, 1}});
+                spec.parameters.push_back(poly.parameters[i]);
+            }
+        }
+
+        MonomialMap expanded;
+        try
+        {
+            expanded = symbolic_call(poly, args);
+        }
+        catch (const ExpansionLimitExceeded &e)
+        {
+            end_symbolic();
+            unspecializable.insert(key);
+            return false;
+        }
+        end_symbolic();
+
+        // Only worth it when fewer terms remain to evaluate at run time.
+        if ((int)expanded.size() >= count_terms(poly.body))
+        {
+            unspecializable.insert(key);
+            return false;
+        }
+        spec.body = body_from_monomials(ast, expanded, remaining.size());
+        symbolTable[key] = spec;
+    }
+
+    pe->poly_name = key;
+    pe->arguments = remaining;
+    return true;
+}
+
+bool Parser::fold_poly_eval(PolyEval *pe, const vector<bool> &known, const vector<int> &known_value,
+                            int &folded, int &specialized)
+{
+    // Returns true when every argument folds to a number.
+    size_t constant_args = 0;
+    for (Value *arg : pe->arguments)
+    {
+        if (fold_value(arg, known, known_value, folded, specialized))
+        {
+            constant_args++;
+        }
+    }
+    if (constant_args == pe->arguments.size())
+    {
+        return true;
+    }
+    if (constant_args > 0 && specialize_call(pe))
+    {
+        specialized++;
+    }
+    return false;
+}
+
+bool Parser::fold_value(Value *v, const vector<bool> &known, const vector<int> &known_value,
+                        int &folded, int &specialized)
+{
+    // Rewrites v to a number when its value is known. Returns true if v is
+    // a number afterwards.
+    switch (v->type)
+    {
+    case NUM_TYPE:
+        return true;
+    case ID_TYPE:
+    {
+        int location = v->location;
+        if (known[location])
+        {
+            v->type = NUM_TYPE;
+            v->value = known_value[location];
+            return true;
+        }
+        return false;
+    }
+    case POLY_EVAL_TYPE:
+        if (fold_poly_eval(v->poly_eval, known, known_value, folded, specialized))
+        {
+            v->value = eval_poly(v->poly_eval, this);
+            v->type = NUM_TYPE;
+            folded++;
+            return true;
+        }
+        return false;
+    }
+    return false;
+}
+
+void Parser::fold_constants()
+{
+    // Walk the straight-line program forward, tracking which variables hold
+    // a known constant. Memory starts out zero, so every variable is known
+    // until it is read by INPUT or assigned a value that is not constant.
+    vector<bool> known(mem.size(), true);
+    vector<int> known_value(mem.size(), 0);
+    int folded = 0;
+    int specialized = 0;
+
+    for (StatementNode *stmt : program)
+    {
+        int location = stmt->location;
+        switch (stmt->type)
+        {
+        case INPUT_STMT:
+            known[location] = false;
+            break;
+        case OUTPUT_STMT:
+            break;
+        case ASSIGN_STMT:
+            if (fold_poly_eval(stmt->poly_eval, known, known_value, folded, specialized))
+            {
+                Value *constant = ast.make<Value>();
+                constant->type = NUM_TYPE;
+                constant->value = eval_poly(stmt->poly_eval, this);
+                stmt->type = COPY_STMT;
+                stmt->value = constant;
+                folded++;
+            }
+            else
+            {
+                known[location] = false;
+                break;
+            }
+            // The statement is now a constant COPY.
+            [[fallthrough]];
+        case COPY_STMT:
+            known[location] = fold_value(stmt->value, known, known_value, folded, specialized);
+            if (known[location])
+            {
+                known_value[location] = stmt->value->value;
+            }
+            break;
+        }
+    }
+
+    error_stream << "fold: " << folded << " constant calls folded, " << specialized << " calls specialized" << endl;
+}
+
+// --- Dead statement elimination ---
+
+void Parser::mark_live(Value *v, vector<bool> &live)
+{
+    switch (v->type)
+    {
+    case NUM_TYPE:
+        break;
+    case ID_TYPE:
+        live[v->location] = true;
+        break;
+    case POLY_EVAL_TYPE:
+        for (Value *arg : v->poly_eval->arguments)
+        {
+            mark_live(arg, live);
+        }
+        break;
+    }
+}
+
+void Parser::eliminate_dead_statements()
+{
+    // Walk the program backward, tracking which variables may still be read
+    // by a later OUTPUT. An assignment to a variable that is not live is
+    // dropped. INPUT statements always stay: they consume from inputs, and
+    // when the inputs run out they leave the old value in place, so they do
+    // not end the liveness of their variable either.
+    vector<bool> live(mem.size(), false);
+    vector<StatementNode *> kept;
+    int eliminated = 0;
+
+    for (auto it = program.rbegin(); it != program.rend(); ++it)
+    {
+        StatementNode *stmt = *it;
+        int location = stmt->location;
+        switch (stmt->type)
+        {
+        case INPUT_STMT:
+            break;
+        case OUTPUT_STMT:
+            live[location] = true;
+            break;
+        case ASSIGN_STMT:
+        case COPY_STMT:
+            if (!live[location])
+            {
+                eliminated++;
+                continue;
+            }
+            live[location] = false;
+            if (stmt->type == ASSIGN_STMT)
+            {
+                for (Value *arg : stmt->poly_eval->arguments)
+                {
+                    mark_live(arg, live);
+                }
+            }
+            else
+            {
+                mark_live(stmt->value, live);
+            }
+            break;
+        }
+        kept.push_back(stmt);
+    }
+
+    program.assign(kept.rbegin(), kept.rend());
+    error_stream << "dce: " << eliminated << " dead statements eliminated" << endl;
+}
+
+// --- Common subexpression elimination ---
+
+string Parser::value_number(Value *v, const vector<int> &version)
+{
+    // Two values get the same number exactly when they compute the same
+    // thing: the same numbers, the same reaching definitions of their
+    // variables and the same calls on those.
+    switch (v->type)
+    {
+    case NUM_TYPE:
+        return "#" + to_string(v->value);
+    case ID_TYPE:
+    {
+        int location = v->location;
+        return "@" + to_string(location) + "." + to_string(version[location]);
+    }
+    case POLY_EVAL_TYPE:
+    {
+        string key = v->poly_eval->poly_name + "(";
+        for (size_t i = 0; i < v->poly_eval->arguments.size(); ++i)
+        {
+            key += (i > 0 ? "," : "") + value_number(v->poly_eval->arguments[i], version);
+        }
+        return key + ")";
+    }
+    }
+    return "";
+}
+
+void Parser::count_subexpressions(Value *v, const vector<int> &version, map<string, int> &counts)
+{
+    if (v->type != POLY_EVAL_TYPE)
+    {
+        return;
+    }
+    // The calls inside a repeated call are computed once along with it, so
+    // only the first occurrence counts them.
+    if (counts[value_number(v, version)]++ > 0)
+    {
+        return;
+    }
+    for (Value *arg : v->poly_eval->arguments)
+    {
+        count_subexpressions(arg, version, counts);
+    }
+}
+
+void Parser::reuse_subexpressions(Value *v, const vector<int> &version, const map<string, int> &counts,
+                                  map<string, int> &temps, vector<StatementNode *> &out, int &reused)
+{
+    if (v->type != POLY_EVAL_TYPE)
+    {
+        return;
+    }
+    string key = value_number(v, version);
+    auto temp = temps.find(key);
+    if (temp != temps.end())
+    {
+        v->type = ID_TYPE;
+        v->location = temp->second;
+        reused++;
+        return;
+    }
+    for (Value *arg : v->poly_eval->arguments)
+    {
+        reuse_subexpressions(arg, version, counts, temps, out, reused);
+    }
+    if (counts.at(key) > 1)
+    {
+        // First of several occurrences: compute it into a temporary slot
+        // just before the statement that needs it. '$' cannot start an ID,
+        // so the name never clashes with a program variable.
+        StatementNode *stmt = ast.make<StatementNode>();
+        stmt->type = ASSIGN_STMT;
+        stmt->location = get_location("$cse" + to_string(temps.size()));
+        stmt->poly_eval = v->poly_eval;
+        out.push_back(stmt);
+        temps[key] = stmt->location;
+        v->type = ID_TYPE;
+        v->location = stmt->location;
+    }
+}
+
+void Parser::eliminate_common_subexpressions()
+{
+    // The right-hand side of every assignment is wrapped in a Value so that
+    // whole statements and nested calls are numbered the same way.
+    vector<Value *> rhs(program.size(), nullptr);
+    for (size_t i = 0; i < program.size(); ++i)
+    {
+        if (program[i]->type == ASSIGN_STMT)
+        {
+            rhs[i] = ast.make<Value>();
+            rhs[i]->type = POLY_EVAL_TYPE;
+            rhs[i]->poly_eval = program[i]->poly_eval;
+        }
+        else if (program[i]->type == COPY_STMT)
+        {
+            rhs[i] = program[i]->value;
+        }
+    }
+
+    // Every statement that writes a variable starts a new definition of it.
+    // Both passes replay the same definitions, so they agree on the numbers.
+    map<string, int> counts;
+    vector<int> version(mem.size(), 0);
+    for (size_t i = 0; i < program.size(); ++i)
+    {
+        if (rhs[i])
+        {
+            count_subexpressions(rhs[i], version, counts);
+        }
+        if (program[i]->type != OUTPUT_STMT)
+        {
+            version[program[i]->location]++;
+        }
+    }
+
+    map<string, int> temps;
+    vector<StatementNode *> rewritten;
+    int reused = 0;
+    fill(version.begin(), version.end(), 0);
+    for (size_t i = 0; i < program.size(); ++i)
+    {
+        StatementNode *stmt = program[i];
+        if (rhs[i])
+        {
+            reuse_subexpressions(rhs[i], version, counts, temps, rewritten, reused);
+            if (rhs[i]->type == POLY_EVAL_TYPE)
+            {
+                stmt->poly_eval = rhs[i]->poly_eval;
+            }
+            else
+            {
+                stmt->type = COPY_STMT;
+                stmt->value = rhs[i];
+            }
+        }
+        if (stmt->type != OUTPUT_STMT)
+        {
+            version[stmt->location]++;
+        }
+        rewritten.push_back(stmt);
+    }
+
+    program = rewritten;
+    error_stream << "cse: " << reused << " repeated calls reused from " << temps.size() << " temporaries" << endl;
+}
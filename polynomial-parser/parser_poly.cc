@@ -13,10 +13,9 @@ void Parser::parse_poly_decl_list()
     parse_poly_decl();
 
     // Check if another declaration follows
-    Token t = lexer.peek(1);
-    if (t.token_type == ID)
+    while (lexer.peek(1).token_type == ID)
     {
-        parse_poly_decl_list();
+        parse_poly_decl();
     }
 }
 void Parser::parse_poly_decl()
@@ -41,6 +40,7 @@ void Parser::parse_poly_decl()
     else
     {
         // Add to symbol table BEFORE parsing body.
+        new_poly.index = poly_order.size();
         symbolTable[new_poly.name] = new_poly;
         poly_order.push_back(new_poly.name); // Store declaration order
         expect(EQUAL);
@@ -74,27 +74,73 @@ void Parser::parse_poly_header(Polynomial &poly)
 
 PolyBody *Parser::parse_poly_body(const Polynomial &poly)
 {
-    PolyBody *body = new PolyBody();
+    PolyBody *body = ast.make<PolyBody>();
     body->terms.push_back({'+', parse_term(poly)}); // First term is always positive
     parse_term_list_prime(poly, body);
+    return intern_body(body, poly);
+}
+
+size_t Parser::BodyKeyHash::operator()(const std::vector<int> &key) const
+{
+    // FNV-1a over the key words with a final mix, as in the memo cache.
+    uint64_t h = 1469598103934665603ULL;
+    for (int word : key)
+    {
+        h = (h ^ (uint32_t)word) * 1099511628211ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+PolyBody *Parser::intern_body(PolyBody *body, const Polynomial &poly)
+{
+    // Nested lists are interned before the body that contains them, so a
+    // body is identified by its parameter list and, per term, the operator,
+    // coefficient, powers and the ids of its lists.
+    auto list = parameter_lists.emplace(poly.parameters, parameter_lists.size()).first;
+    std::vector<int> key;
+    key.push_back(list->second);
+    for (auto &term_pair : body->terms)
+    {
+        Term *term = term_pair.second;
+        key.push_back(term_pair.first);
+        key.push_back(term->coefficient);
+        key.insert(key.end(), term->monomial_power_vector.begin(), term->monomial_power_vector.end());
+        key.push_back(term->parenthesized_lists.size());
+        for (PolyBody *sub_body : term->parenthesized_lists)
+        {
+            key.push_back(sub_body->id);
+        }
+    }
+
+    auto found = interned_bodies.find(key);
+    if (found != interned_bodies.end())
+    {
+        found->second->shared = true;
+        return found->second;
+    }
+    body->id = interned_bodies.size();
+    interned_bodies.emplace(std::move(key), body);
     return body;
 }
 
 void Parser::parse_term_list_prime(const Polynomial &poly, PolyBody *body)
 {
     Token t = lexer.peek(1);
-    if (t.token_type == PLUS || t.token_type == MINUS)
+    while (t.token_type == PLUS || t.token_type == MINUS)
     {
         char op = (t.token_type == PLUS) ? '+' : '-';
         expect(t.token_type); // Consume PLUS or MINUS
         body->terms.push_back({op, parse_term(poly)});
-        parse_term_list_prime(poly, body);
+        t = lexer.peek(1);
     }
 }
 
 Term *Parser::parse_term(const Polynomial &poly)
 {
-    Term *term = new Term();
+    Term *term = ast.make<Term>();
     term->monomial_power_vector.resize(poly.parameters.size(), 0);
 
     Token t = lexer.peek(1);
@@ -135,25 +181,20 @@ void Parser::parse_parenthesized_list(const Polynomial &poly, Term *term)
     // parenthesized_list -> LPAREN term_list RPAREN
     // parenthesized_list -> LPAREN term_list RPAREN parenthesized_list
 
-    expect(LPAREN);
-    term->parenthesized_lists.push_back(parse_poly_body(poly));
-    expect(RPAREN);
-
-    Token t = lexer.peek(1);
-    if (t.token_type == LPAREN)
+    do
     {
-        parse_parenthesized_list(poly, term);
-    }
+        expect(LPAREN);
+        term->parenthesized_lists.push_back(parse_poly_body(poly));
+        expect(RPAREN);
+    } while (lexer.peek(1).token_type == LPAREN);
 }
 
 void Parser::parse_monomial_list(const Polynomial &poly, Term *term)
 {
     parse_monomial(poly, term);
-
-    Token t = lexer.peek(1);
-    if (t.token_type == ID)
+    while (lexer.peek(1).token_type == ID)
     {
-        parse_monomial_list(poly, term);
+        parse_monomial(poly, term);
     }
 }
 
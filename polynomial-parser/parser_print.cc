@@ -18,20 +18,20 @@ void Parser::print_poly_body_task3(const PolyBody *body, const Polynomial &poly)
 
         if (i > 0)
         {
-            cout << " " << op << " ";
+            output_stream << " " << op << " ";
         }
         else if (op == '-')
         {
-            cout << "-";
+            output_stream << "-";
         }
 
         if (!term->parenthesized_lists.empty())
         {
             for (const auto &sub_body : term->parenthesized_lists)
             {
-                cout << "(";
+                output_stream << "(";
                 print_poly_body_task3(sub_body, poly);
-                cout << ")";
+                output_stream << ")";
             }
         }
         else
@@ -48,17 +48,17 @@ void Parser::print_poly_body_task3(const PolyBody *body, const Polynomial &poly)
 
             if (abs(term->coefficient) != 1 || is_constant)
             {
-                cout << abs(term->coefficient);
+                output_stream << abs(term->coefficient);
             }
 
             for (size_t j = 0; j < term->monomial_power_vector.size(); ++j)
             {
                 if (term->monomial_power_vector[j] > 0)
                 {
-                    cout << poly.parameters[j];
+                    output_stream << poly.parameters[j];
                     if (term->monomial_power_vector[j] > 1)
                     {
-                        cout << "^" << term->monomial_power_vector[j];
+                        output_stream << "^" << term->monomial_power_vector[j];
                     }
                 }
             }
@@ -68,36 +68,36 @@ void Parser::print_poly_body_task3(const PolyBody *body, const Polynomial &poly)
 
 void Parser::print_poly_task3(const Polynomial &poly)
 {
-    cout << "    " << poly.name;
+    output_stream << "    " << poly.name;
     if (poly.explicit_parameters)
     {
-        cout << "(";
+        output_stream << "(";
         for (size_t i = 0; i < poly.parameters.size(); ++i)
         {
-            cout << poly.parameters[i] << (i == poly.parameters.size() - 1 ? "" : ",");
+            output_stream << poly.parameters[i] << (i == poly.parameters.size() - 1 ? "" : ",");
         }
-        cout << ")";
+        output_stream << ")";
     }
-    cout << " = ";
+    output_stream << " = ";
     print_poly_body_task3(poly.body, poly);
-    cout << " ;" << endl;
+    output_stream << " ;" << endl;
 }
 
 void Parser::print_poly_task4(const Polynomial &poly)
 {
-    cout << "    " << poly.name;
+    output_stream << "    " << poly.name;
     if (poly.explicit_parameters)
     {
-        cout << "(";
+        output_stream << "(";
         for (size_t i = 0; i < poly.parameters.size(); ++i)
         {
-            cout << poly.parameters[i] << (i == poly.parameters.size() - 1 ? "" : ",");
+            output_stream << poly.parameters[i] << (i == poly.parameters.size() - 1 ? "" : ",");
         }
-        cout << ")";
+        output_stream << ")";
     }
-    cout << " = ";
+    output_stream << " = ";
     print_poly_body_task4(poly.body, poly);
-    cout << " ;" << endl;
+    output_stream << " ;" << endl;
 }
 
 void Parser::print_poly_body_task4(PolyBody *body, const Polynomial &poly)
@@ -145,18 +145,18 @@ void Parser::print_poly_body_task4(PolyBody *body, const Polynomial &poly)
 
             if (first_term_printed)
             {
-                cout << " " << op << " ";
+                output_stream << " " << op << " ";
             }
             else if (op == '-')
             {
-                cout << "-";
+                output_stream << "-";
             }
 
             for (size_t i = 0; i < term_to_print->parenthesized_lists.size(); ++i)
             {
-                cout << "(";
+                output_stream << "(";
                 print_poly_body_task4(term_to_print->parenthesized_lists[i], poly);
-                cout << ")";
+                output_stream << ")";
             }
             first_term_printed = true;
         }
@@ -171,11 +171,11 @@ void Parser::print_poly_body_task4(PolyBody *body, const Polynomial &poly)
 
             if (first_term_printed)
             {
-                cout << " " << op << " ";
+                output_stream << " " << op << " ";
             }
             else if (op == '-')
             {
-                cout << "-";
+                output_stream << "-";
             }
 
             const auto &power_vector = term_to_print->monomial_power_vector;
@@ -191,17 +191,17 @@ void Parser::print_poly_body_task4(PolyBody *body, const Polynomial &poly)
 
             if (abs_coefficient != 1 || is_constant)
             {
-                cout << abs_coefficient;
+                output_stream << abs_coefficient;
             }
 
             for (size_t j = 0; j < power_vector.size(); ++j)
             {
                 if (power_vector[j] > 0)
                 {
-                    cout << poly.parameters[j];
+                    output_stream << poly.parameters[j];
                     if (power_vector[j] > 1)
                     {
-                        cout << "^" << power_vector[j];
+                        output_stream << "^" << power_vector[j];
                     }
                 }
             }
@@ -212,36 +212,52 @@ void Parser::print_poly_body_task4(PolyBody *body, const Polynomial &poly)
 
 void Parser::print_poly_task5(const Polynomial &poly)
 {
-    cout << "    " << poly.name;
+    output_stream << "    " << poly.name;
     if (poly.explicit_parameters)
     {
-        cout << "(";
+        output_stream << "(";
         for (size_t i = 0; i < poly.parameters.size(); ++i)
         {
-            cout << poly.parameters[i] << (i == poly.parameters.size() - 1 ? "" : ",");
+            output_stream << poly.parameters[i] << (i == poly.parameters.size() - 1 ? "" : ",");
         }
-        cout << ")";
+        output_stream << ")";
     }
-    cout << " = ";
-    PolyBody *expanded_body = expand_poly_body(poly.body, poly);
-    
-    map<vector<int>, int> combined_terms;
-    for (const auto &pair : expanded_body->terms)
+    output_stream << " = ";
+
+    if (numeric_mode != NUMERIC_INT32)
+    {
+        print_poly_task5_numeric(poly);
+        return;
+    }
+
+    MonomialMap combined_terms;
+    try
     {
-        int sign = (pair.first == '+') ? 1 : -1;
-        combined_terms[pair.second->monomial_power_vector] += sign * pair.second->coefficient;
+        combined_terms = expand_polynomial(poly);
     }
+    catch (const ExpansionLimitExceeded &e)
+    {
+        output_stream << "EXPANSION LIMIT EXCEEDED (more than " << e.limit << " terms) ;" << endl;
+        return;
+    }
+    print_expanded_terms(combined_terms, poly);
+}
 
-    vector<pair<vector<int>, int>> sorted_terms;
+// Prints expanded terms by decreasing degree, then decreasing power vector,
+// for any numeric mode.
+template <class N>
+void Parser::print_expanded_terms(const map<vector<int>, N> &combined_terms, const Polynomial &poly)
+{
+    vector<pair<vector<int>, N>> sorted_terms;
     for (auto const &term : combined_terms)
     {
-        if (term.second != 0)
+        if (!numeric_is_zero(term.second))
         {
             sorted_terms.push_back(term);
         }
     }
 
-    sort(sorted_terms.begin(), sorted_terms.end(), [](const pair<vector<int>, int> &a, const pair<vector<int>, int> &b) {
+    sort(sorted_terms.begin(), sorted_terms.end(), [](const pair<vector<int>, N> &a, const pair<vector<int>, N> &b) {
         int degree_a = 0;
         for (int p : a.first) degree_a += p;
         int degree_b = 0;
@@ -258,17 +274,16 @@ void Parser::print_poly_task5(const Polynomial &poly)
     for (const auto &term : sorted_terms)
     {
         const auto &power_vector = term.first;
-        int total_coefficient = term.second;
-        char op = (total_coefficient > 0) ? '+' : '-';
-        int abs_coefficient = abs(total_coefficient);
+        char op = numeric_is_negative(term.second) ? '-' : '+';
+        string abs_coefficient = numeric_abs_string(term.second);
 
         if (!first_term)
         {
-            cout << " " << op << " ";
+            output_stream << " " << op << " ";
         }
         else if (op == '-')
         {
-            cout << "-";
+            output_stream << "-";
         }
 
         bool is_constant = true;
@@ -281,82 +296,29 @@ void Parser::print_poly_task5(const Polynomial &poly)
             }
         }
 
-        if (abs_coefficient != 1 || is_constant)
+        if (abs_coefficient != "1" || is_constant)
         {
-            cout << abs_coefficient;
+            output_stream << abs_coefficient;
         }
 
         for (size_t j = 0; j < power_vector.size(); ++j)
         {
             if (power_vector[j] > 0)
             {
-                cout << poly.parameters[j];
+                output_stream << poly.parameters[j];
                 if (power_vector[j] > 1)
                 {
-                    cout << "^" << power_vector[j];
+                    output_stream << "^" << power_vector[j];
                 }
             }
         }
         first_term = false;
     }
 
-    cout << " ;" << endl;
+    output_stream << " ;" << endl;
 }
 
-PolyBody* Parser::expand_poly_body(PolyBody *body, const Polynomial &poly)
-{
-    PolyBody *expanded_body = new PolyBody();
-
-    for (auto &term_pair : body->terms)
-    {
-        char op = term_pair.first;
-        Term *term = term_pair.second;
-
-        if (term->parenthesized_lists.empty())
-        {
-            expanded_body->terms.push_back({op, term});
-        }
-        else
-        {
-            PolyBody *current_expansion = new PolyBody();
-            Term *initial_term = new Term();
-            initial_term->coefficient = 1;
-            initial_term->monomial_power_vector.resize(poly.parameters.size(), 0);
-            current_expansion->terms.push_back({'+', initial_term});
-
-            for (auto &sub_body : term->parenthesized_lists)
-            {
-                PolyBody *expanded_sub_body = expand_poly_body(sub_body, poly);
-                PolyBody *next_expansion = new PolyBody();
-                
-                for (auto const &t1 : current_expansion->terms)
-                {
-                    for (auto const &t2 : expanded_sub_body->terms)
-                    {
-                        Term *new_term = new Term();
-                        new_term->coefficient = t1.second->coefficient * t2.second->coefficient;
-                        
-                        new_term->monomial_power_vector.resize(poly.parameters.size());
-                        for (size_t i = 0; i < poly.parameters.size(); ++i)
-                        {
-                            new_term->monomial_power_vector[i] = t1.second->monomial_power_vector[i] + t2.second->monomial_power_vector[i];
-                        }
-                        
-                        char new_op = (t1.first == t2.first) ? '+' : '-';
-                        next_expansion->terms.push_back({new_op, new_term});
-                    }
-                }
-                current_expansion = next_expansion;
-            }
-            
-            for (auto &new_term_pair : current_expansion->terms)
-            {
-                new_term_pair.second->coefficient *= term->coefficient;
-                char final_op = (op == new_term_pair.first) ? '+' : '-';
-                expanded_body->terms.push_back({final_op, new_term_pair.second});
-            }
-        }
-    }
-
-    return expanded_body;
-}
+template void Parser::print_expanded_terms<int>(const map<vector<int>, int> &, const Polynomial &);
+template void Parser::print_expanded_terms<Checked64>(const map<vector<int>, Checked64> &, const Polynomial &);
+template void Parser::print_expanded_terms<BigInt>(const map<vector<int>, BigInt> &, const Polynomial &);
+template void Parser::print_expanded_terms<ModInt>(const map<vector<int>, ModInt> &, const Polynomial &);
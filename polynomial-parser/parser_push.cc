@@ -0,0 +1,115 @@
+#include "parser.h"
+#include <string>
+#include <vector>
+#include <map>
+
+using namespace std;
+
+// Push parsing: the program is handed over in chunks as it arrives instead
+// of being read when the parser is made. The recursive descent parser runs
+// on a thread of its own and waits in the lexer for tokens that have not
+// arrived, so it stops exactly where it would stop on the whole input and
+// the results do not depend on how the input was cut. As each section is
+// done its results are published: the task list after TASKS, and after
+// POLY the semantic errors found so far and, when asked for, the compiled
+// polynomials. finish() waits for the rest and throws the errors of the
+// whole program, as parse_and_check does.
+
+Parser::~Parser()
+{
+    if (push_thread.joinable())
+    {
+        lexer.Finish();
+        push_thread.join();
+    }
+}
+
+void Parser::compile_polys_on_push()
+{
+    compile_on_push = true;
+}
+
+void Parser::push(const char *data, size_t size)
+{
+    lexer.Push(string(data, size));
+    if (!push_started)
+    {
+        push_started = true;
+        push_thread = thread([this]() { parse_pushed_program(); });
+    }
+}
+
+void Parser::finish()
+{
+    lexer.Finish();
+    if (!push_started)
+    {
+        push_started = true;
+        parse_pushed_program();
+    }
+    else
+    {
+        push_thread.join();
+    }
+    if (push_error)
+    {
+        rethrow_exception(push_error);
+    }
+}
+
+void Parser::parse_pushed_program()
+{
+    try
+    {
+        parse_tasks_section();
+        tasks_done = true;
+
+        parse_poly_section();
+        poly_errors = errors;
+        if (compile_on_push && errors.empty())
+        {
+            compile_polys();
+        }
+        polys_done = true;
+
+        parse_execute_section();
+        parse_inputs_section();
+        expect(END_OF_FILE);
+        report_errors();
+    }
+    catch (...)
+    {
+        push_error = current_exception();
+    }
+}
+
+bool Parser::tasks_parsed() const
+{
+    return tasks_done;
+}
+
+const vector<int> &Parser::parsed_tasks() const
+{
+    return tasks;
+}
+
+bool Parser::polys_parsed() const
+{
+    return polys_done;
+}
+
+const map<string, vector<int>> &Parser::poly_section_errors() const
+{
+    return poly_errors;
+}
+
+const CompiledPoly *Parser::compiled_poly(const string &name) const
+{
+    auto it = symbolTable.find(name);
+    if (it == symbolTable.end() || (size_t)it->second.index >= polys_compiled.size() ||
+        !polys_compiled[it->second.index])
+    {
+        return nullptr;
+    }
+    return &compiled_polys[it->second.index];
+}
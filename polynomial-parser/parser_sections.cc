@@ -26,10 +26,10 @@ void Parser::parse_num_list(std::vector<int> &list)
     list.push_back(std::stoi(num_token.lexeme));
 
     // After the first NUM, we check if there's another one.
-    Token t = lexer.peek(1);
-    if (t.token_type == NUM)
+    while (lexer.peek(1).token_type == NUM)
     {
-        parse_num_list(list); // Recursive call for the rest of the list
+        num_token = expect(NUM);
+        list.push_back(std::stoi(num_token.lexeme));
     }
 }
 void Parser::parse_num_list()
@@ -44,10 +44,9 @@ void Parser::parse_num_list()
     // After the first NUM, we check if there's another one.
     // The peek() function is perfect for this. It lets us look ahead
     // at the next token without consuming it.
-    Token t = lexer.peek(1);
-    if (t.token_type == NUM)
+    while (lexer.peek(1).token_type == NUM)
     {
-        parse_num_list(); // Recursive call for the rest of the list
+        expect(NUM);
     }
 }
 
@@ -69,10 +68,10 @@ void Parser::parse_id_list(std::vector<std::string> &params)
     params.push_back(id_token.lexeme);
 
     // After the first ID, we might see a comma for the next one.
-    Token t = lexer.peek(1);
-    if (t.token_type == COMMA)
+    while (lexer.peek(1).token_type == COMMA)
     {
         expect(COMMA);
-        parse_id_list(params); // Recursively parse the rest of the list.
+        id_token = expect(ID);
+        params.push_back(id_token.lexeme);
     }
 }
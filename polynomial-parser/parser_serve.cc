@@ -0,0 +1,383 @@
+#include "parser.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+using namespace std;
+
+// Server mode: the program is parsed, checked and optimized once, every
+// polynomial that expands within SERVE_COMPILE_TERMS terms is compiled,
+// and then requests are answered until the input ends or a SHUTDOWN
+// request arrives. Requests and replies are single lines:
+//
+//   EVAL NAME a b ... [; a b ...]   value of NAME at each argument vector
+//   RUN i1 i2 ...                   outputs of EXECUTE with these INPUTS
+//   STATS                           request count and p50/p99 latency
+//   SHUTDOWN                        stop serving
+//
+// A reply is "OK" followed by the values, or "ERR" and a message. Replies
+// on one connection come back in request order. All complete lines that
+// arrive together are answered together on the thread pool.
+
+static const size_t SERVE_COMPILE_TERMS = 4096;
+
+typedef chrono::steady_clock Clock;
+
+void Parser::compile_polys()
+{
+    // Polynomials with a repeated parameter name keep the tree evaluator,
+    // which gives such a parameter its last argument.
+    size_t saved_limit = max_expanded_terms;
+    max_expanded_terms = min(max_expanded_terms, SERVE_COMPILE_TERMS);
+    compiled_polys.assign(poly_order.size(), CompiledPoly());
+    polys_compiled.assign(poly_order.size(), false);
+    for (const string &name : poly_order)
+    {
+        const Polynomial &poly = symbolTable.at(name);
+        set<string> distinct(poly.parameters.begin(), poly.parameters.end());
+        if (distinct.size() != poly.parameters.size())
+        {
+            continue;
+        }
+        try
+        {
+            compiled_polys[poly.index] = compile_polynomial(poly);
+            polys_compiled[poly.index] = true;
+        }
+        catch (const ExpansionLimitExceeded &e)
+        {
+        }
+    }
+    max_expanded_terms = saved_limit;
+}
+
+static string latency_stats(const LatencyHistogram &latency)
+{
+    return "requests " + to_string(latency.count()) + " p50 " + to_string(latency.percentile(0.50) / 1000) +
+           "us p99 " + to_string(latency.percentile(0.99) / 1000) + "us";
+}
+
+string Parser::answer_request(const string &request)
+{
+    size_t start = request.find_first_not_of(" \t\r");
+    if (start == string::npos)
+    {
+        return "ERR empty request\n";
+    }
+    size_t end = request.find_first_of(" \t\r", start);
+    string command = request.substr(start, end == string::npos ? string::npos : end - start);
+    string rest = (end == string::npos) ? string() : request.substr(end);
+
+    if (command == "EVAL")
+    {
+        size_t name_start = rest.find_first_not_of(" \t\r");
+        if (name_start == string::npos)
+        {
+            return "ERR EVAL needs a polynomial name\n";
+        }
+        size_t name_end = rest.find_first_of(" \t\r;", name_start);
+        string name = rest.substr(name_start, name_end == string::npos ? string::npos : name_end - name_start);
+        if (symbolTable.count(name) == 0)
+        {
+            return "ERR unknown polynomial " + name + "\n";
+        }
+        const Polynomial &poly = symbolTable.at(name);
+
+        string reply = "OK";
+        vector<int> args;
+        map<string, int> arg_values;
+        size_t pos = (name_end == string::npos) ? rest.size() : name_end;
+        while (true)
+        {
+            size_t semicolon = rest.find(';', pos);
+            if (!parse_batch(rest.substr(pos, semicolon == string::npos ? string::npos : semicolon - pos), args))
+            {
+                return "ERR arguments must be numbers\n";
+            }
+            if (args.size() != poly.parameters.size())
+            {
+                return "ERR " + name + " takes " + to_string(poly.parameters.size()) + " arguments\n";
+            }
+            int value;
+            if (polys_compiled[poly.index])
+            {
+                value = eval_compiled(compiled_polys[poly.index], args.data());
+            }
+            else
+            {
+                for (size_t i = 0; i < args.size(); ++i)
+                {
+                    arg_values[poly.parameters[i]] = args[i];
+                }
+                value = eval_poly_body(poly.body, poly.parameters, arg_values, this);
+            }
+            reply += ' ';
+            reply += to_string(value);
+            if (semicolon == string::npos)
+            {
+                break;
+            }
+            pos = semicolon + 1;
+        }
+        return reply + "\n";
+    }
+    if (command == "RUN")
+    {
+        vector<int> batch;
+        if (!parse_batch(rest, batch))
+        {
+            return "ERR inputs must be numbers\n";
+        }
+        string out;
+        run_batch_numeric(batch, out);
+        string reply = "OK ";
+        for (char c : out)
+        {
+            reply += (c == '\n') ? ' ' : c;
+        }
+        if (reply.back() == ' ')
+        {
+            reply.pop_back();
+        }
+        return reply + "\n";
+    }
+    if (command == "STATS")
+    {
+        return "OK " + latency_stats(request_latency) + "\n";
+    }
+    if (command == "SHUTDOWN")
+    {
+        serve_stopping = true;
+        if (serve_listener >= 0)
+        {
+            shutdown(serve_listener, SHUT_RDWR);
+        }
+        return "OK\n";
+    }
+    return "ERR unknown request " + command + "\n";
+}
+
+static bool write_all(int fd, const string &data)
+{
+    size_t written = 0;
+    while (written < data.size())
+    {
+        ssize_t n = write(fd, data.data() + written, data.size() - written);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        written += n;
+    }
+    return true;
+}
+
+void Parser::serve_connection(int in_fd, int out_fd)
+{
+    string buffer;
+    vector<string> requests;
+    vector<string> replies;
+    char chunk[1 << 16];
+    bool open = true;
+    while (open && !serve_stopping)
+    {
+        ssize_t n = read(in_fd, chunk, sizeof(chunk));
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n > 0)
+        {
+            buffer.append(chunk, n);
+        }
+        else
+        {
+            // A last request without a newline still gets its answer.
+            open = false;
+            if (!buffer.empty())
+            {
+                buffer += '\n';
+            }
+        }
+
+        requests.clear();
+        size_t line_start = 0;
+        for (size_t newline; (newline = buffer.find('\n', line_start)) != string::npos; line_start = newline + 1)
+        {
+            requests.push_back(buffer.substr(line_start, newline - line_start));
+        }
+        buffer.erase(0, line_start);
+        if (requests.empty())
+        {
+            continue;
+        }
+
+        Clock::time_point arrival = Clock::now();
+        replies.assign(requests.size(), string());
+        auto answer_range = [this, &requests, &replies, arrival](size_t first, size_t last) {
+            for (size_t i = first; i < last; ++i)
+            {
+                replies[i] = answer_request(requests[i]);
+                request_latency.record(chrono::duration_cast<chrono::nanoseconds>(Clock::now() - arrival).count());
+            }
+        };
+        if (pool && requests.size() > 1)
+        {
+            TaskGroup group(*pool);
+            size_t num_tasks = min<size_t>(pool->size(), requests.size());
+            for (size_t t = 0; t < num_tasks; ++t)
+            {
+                size_t first = requests.size() * t / num_tasks;
+                size_t last = requests.size() * (t + 1) / num_tasks;
+                group.run([&answer_range, first, last]() { answer_range(first, last); });
+            }
+            group.wait();
+        }
+        else
+        {
+            answer_range(0, requests.size());
+        }
+
+        string out;
+        for (const string &reply : replies)
+        {
+            out += reply;
+        }
+        if (!write_all(out_fd, out))
+        {
+            break;
+        }
+    }
+}
+
+void Parser::serve_socket(const string &path)
+{
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path))
+    {
+        cerr << "--serve: socket path too long: " << path << endl;
+        exit(1);
+    }
+    strcpy(addr.sun_path, path.c_str());
+
+    // A socket left at PATH by an earlier server is replaced; anything
+    // else there is left alone.
+    struct stat st;
+    if (lstat(path.c_str(), &st) == 0)
+    {
+        if (!S_ISSOCK(st.st_mode))
+        {
+            cerr << "--serve: " << path << " exists and is not a socket" << endl;
+            exit(1);
+        }
+        unlink(path.c_str());
+    }
+
+    serve_listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (serve_listener < 0 || bind(serve_listener, (sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(serve_listener, 64) != 0 || lstat(path.c_str(), &st) != 0)
+    {
+        cerr << "--serve: cannot listen on " << path << ": " << strerror(errno) << endl;
+        exit(1);
+    }
+    dev_t socket_dev = st.st_dev;
+    ino_t socket_ino = st.st_ino;
+
+    // Each connection gets a thread for its reads and writes; the requests
+    // themselves are answered on the pool. Threads of closed connections
+    // are joined as new ones arrive.
+    mutex connections_mutex;
+    map<size_t, int> connections; // Open connections by id
+    map<size_t, thread> handlers;
+    vector<size_t> finished;
+    for (size_t next_id = 0; !serve_stopping; ++next_id)
+    {
+        int fd = accept(serve_listener, nullptr, nullptr);
+        if (fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+            {
+                continue;
+            }
+            break;
+        }
+        lock_guard<mutex> lock(connections_mutex);
+        for (size_t id : finished)
+        {
+            handlers[id].join();
+            handlers.erase(id);
+        }
+        finished.clear();
+        connections[next_id] = fd;
+        handlers[next_id] = thread([this, fd, next_id, &connections, &finished, &connections_mutex]() {
+            serve_connection(fd, fd);
+            close(fd);
+            lock_guard<mutex> lock(connections_mutex);
+            connections.erase(next_id);
+            finished.push_back(next_id);
+        });
+    }
+
+    // Wake the connections still blocked in read so their threads finish.
+    {
+        lock_guard<mutex> lock(connections_mutex);
+        for (auto &connection : connections)
+        {
+            shutdown(connection.second, SHUT_RD);
+        }
+    }
+    for (auto &handler : handlers)
+    {
+        handler.second.join();
+    }
+    close(serve_listener);
+
+    // Only the socket this server bound is removed, not whatever has
+    // replaced it at PATH since.
+    if (lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode) && st.st_dev == socket_dev && st.st_ino == socket_ino)
+    {
+        unlink(path.c_str());
+    }
+}
+
+void Parser::Serve(const string &path)
+{
+    prepare_batch_runs();
+    if (compiled_polys.size() != poly_order.size())
+    {
+        compile_polys();
+    }
+    if (!pool)
+    {
+        set_num_threads(thread::hardware_concurrency());
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    if (path == "-")
+    {
+        serve_connection(0, 1);
+    }
+    else
+    {
+        serve_socket(path);
+    }
+    error_stream << "serve: " << latency_stats(request_latency) << endl;
+}
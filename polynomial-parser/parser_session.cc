@@ -0,0 +1,133 @@
+#include "parser.h"
+#include <iostream>
+#include <istream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Interactive mode: the program is parsed, checked and optimized once, its
+// INPUTS section is run, and then each line read from the session stream
+// is a new INPUTS list for another run. A run replays the statements in
+// order, but an assignment is only evaluated again when one of the
+// locations it reads holds a value different from the last run at the
+// same point; otherwise the value it wrote last time is reused. Only the
+// statements downstream of changed inputs are therefore recomputed. The
+// outputs are written as in --stream, one value per line.
+
+void Parser::prepare_session()
+{
+    statement_uses.assign(program.size(), vector<int>());
+    statement_values.assign(program.size(), 0);
+    for (size_t i = 0; i < program.size(); ++i)
+    {
+        StatementNode *stmt = program[i];
+        if (stmt->type == ASSIGN_STMT)
+        {
+            for (Value *arg : stmt->poly_eval->arguments)
+            {
+                collect_uses(arg, statement_uses[i]);
+            }
+        }
+        else if (stmt->type == COPY_STMT)
+        {
+            collect_uses(stmt->value, statement_uses[i]);
+        }
+    }
+    session_started = false;
+}
+
+void Parser::run_session_batch(const vector<int> &batch, string &out)
+{
+    vector<int> run_mem(mem.size(), 0);
+    vector<bool> changed(mem.size(), false); // Differs from the last run here
+    size_t next = 0;
+    for (size_t i = 0; i < program.size(); ++i)
+    {
+        StatementNode *stmt = program[i];
+        int location = stmt->location;
+        int value;
+        switch (stmt->type)
+        {
+        case INPUT_STMT:
+            value = (next < batch.size()) ? batch[next] : run_mem[location];
+            next++;
+            break;
+        case OUTPUT_STMT:
+            out += to_string(run_mem[location]);
+            out += '\n';
+            continue;
+        default:
+        {
+            bool dirty = !session_started;
+            for (int use : statement_uses[i])
+            {
+                dirty = dirty || changed[use];
+            }
+            session_total++;
+            if (!dirty)
+            {
+                run_mem[location] = statement_values[i];
+                changed[location] = false;
+                continue;
+            }
+            session_recomputed++;
+            value = (stmt->type == ASSIGN_STMT) ? eval_poly(stmt->poly_eval, this, run_mem)
+                                                : eval_value(stmt->value, this, run_mem);
+            break;
+        }
+        }
+        changed[location] = !session_started || value != statement_values[i];
+        statement_values[i] = value;
+        run_mem[location] = value;
+    }
+    session_started = true;
+}
+
+void Parser::SessionInputs(istream &batches)
+{
+    parse_and_check();
+    optimize_program();
+    prepare_session();
+
+    string out;
+    vector<int> batch = inputs;
+    string line;
+    size_t line_no = 0;
+    while (true)
+    {
+        out.clear();
+        if (numeric_mode == NUMERIC_INT32)
+        {
+            run_session_batch(batch, out);
+        }
+        else
+        {
+            run_batch_numeric(batch, out);
+        }
+        output_stream << out;
+        output_stream.flush();
+
+        if (!getline(batches, line))
+        {
+            break;
+        }
+        line_no++;
+        if (!parse_batch(line, batch))
+        {
+            cerr << "--session: line " << line_no << " is not a list of numbers" << endl;
+            exit(1);
+        }
+    }
+
+    if (numeric_mode == NUMERIC_INT32)
+    {
+        error_stream << "session: " << session_recomputed << " of " << session_total
+                     << " assignments recomputed" << endl;
+    }
+    if (memo)
+    {
+        error_stream << "memo: " << memo->hits() << " hits, " << memo->misses() << " misses, "
+                     << memo->evictions() << " evictions" << endl;
+    }
+}
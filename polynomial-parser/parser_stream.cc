@@ -0,0 +1,181 @@
+#include "parser.h"
+#include <iostream>
+#include <istream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cerrno>
+#include <climits>
+#include <algorithm>
+
+using namespace std;
+
+// Throughput mode: the program is parsed, checked and optimized once, and
+// then its EXECUTE section runs once per line of the batch stream. Each
+// line holds the INPUTS of one run. Every run starts from fresh zeroed
+// memory, and the outputs of all runs are written in the order of the
+// lines.
+
+// Lines read before a chunk is run; the outputs of one chunk are held in
+// memory until it is written.
+static const size_t STREAM_CHUNK = 4096;
+
+bool parse_batch(const string &line, vector<int> &batch)
+{
+    batch.clear();
+    const char *p = line.c_str();
+    while (true)
+    {
+        while (*p == ' ' || *p == '\t' || *p == '\r')
+        {
+            p++;
+        }
+        if (*p == '\0')
+        {
+            return true;
+        }
+        char *end;
+        errno = 0;
+        long value = strtol(p, &end, 10);
+        if (end == p || errno != 0 || value < INT_MIN || value > INT_MAX)
+        {
+            return false;
+        }
+        batch.push_back((int)value);
+        p = end;
+    }
+}
+
+void Parser::run_batch(const vector<int> &batch, string &out)
+{
+    if (native_ready)
+    {
+        run_native(batch, out);
+        return;
+    }
+
+    // As in ParseInput, closed forms need a value for every INPUT.
+    if (closed_form_mode && batch.size() >= closed_form_inputs)
+    {
+        for (const CompiledPoly &output : closed_forms)
+        {
+            out += to_string(eval_compiled(output, batch.data()));
+            out += '\n';
+        }
+        return;
+    }
+
+    vector<int> batch_mem(mem.size(), 0);
+    size_t next = 0;
+    for (StatementNode *stmt : program)
+    {
+        int location = stmt->location;
+        switch (stmt->type)
+        {
+        case INPUT_STMT:
+            if (next < batch.size())
+            {
+                batch_mem[location] = batch[next++];
+            }
+            break;
+        case OUTPUT_STMT:
+            out += to_string(batch_mem[location]);
+            out += '\n';
+            break;
+        case ASSIGN_STMT:
+            batch_mem[location] = eval_poly(stmt->poly_eval, this, batch_mem);
+            break;
+        case COPY_STMT:
+            batch_mem[location] = eval_value(stmt->value, this, batch_mem);
+            break;
+        }
+    }
+}
+
+// Parses, checks and optimizes the program for repeated runs of run_batch
+// and its numeric variants.
+void Parser::prepare_batch_runs()
+{
+    parse_and_check();
+    optimize_program();
+    if (numeric_mode != NUMERIC_INT32)
+    {
+        closed_form_mode = false;
+        native_mode = false;
+    }
+    if (native_mode && !prepare_native())
+    {
+        error_stream << "native code unavailable, interpreting the EXECUTE section" << endl;
+        native_mode = false;
+    }
+    if (closed_form_mode && !native_ready && !compile_closed_forms())
+    {
+        error_stream << "closed form unavailable, interpreting the EXECUTE section" << endl;
+        closed_form_mode = false;
+    }
+}
+
+void Parser::StreamInputs(istream &batches)
+{
+    prepare_batch_runs();
+
+    vector<vector<int>> chunk;
+    vector<string> outputs;
+    string line;
+    size_t line_no = 0;
+    bool more = true;
+    while (more)
+    {
+        chunk.clear();
+        while (chunk.size() < STREAM_CHUNK && (more = (bool)getline(batches, line)))
+        {
+            line_no++;
+            vector<int> batch;
+            if (!parse_batch(line, batch))
+            {
+                cerr << "--stream: line " << line_no << " is not a list of numbers" << endl;
+                exit(1);
+            }
+            chunk.push_back(batch);
+        }
+
+        outputs.assign(chunk.size(), string());
+        if (pool && chunk.size() > 1)
+        {
+            // One task per worker, each running a contiguous range of lines.
+            TaskGroup group(*pool);
+            size_t num_tasks = min<size_t>(pool->size(), chunk.size());
+            for (size_t t = 0; t < num_tasks; ++t)
+            {
+                size_t first = chunk.size() * t / num_tasks;
+                size_t last = chunk.size() * (t + 1) / num_tasks;
+                group.run([this, &chunk, &outputs, first, last]() {
+                    for (size_t i = first; i < last; ++i)
+                    {
+                        run_batch_numeric(chunk[i], outputs[i]);
+                    }
+                });
+            }
+            group.wait();
+        }
+        else
+        {
+            for (size_t i = 0; i < chunk.size(); ++i)
+            {
+                run_batch_numeric(chunk[i], outputs[i]);
+            }
+        }
+
+        for (const string &output : outputs)
+        {
+            output_stream << output;
+        }
+        output_stream.flush();
+    }
+
+    if (memo)
+    {
+        error_stream << "memo: " << memo->hits() << " hits, " << memo->misses() << " misses, "
+                     << memo->evictions() << " evictions" << endl;
+    }
+}
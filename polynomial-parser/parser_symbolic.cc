@@ -0,0 +1,216 @@
+#include "parser.h"
+#include <iostream>
+#include <vector>
+#include <map>
+
+using namespace std;
+
+// Closed-form execution runs the EXECUTE section once over symbolic values.
+// The k-th INPUT statement reads the variable x_k, every assignment composes
+// the called polynomial with the symbolic values of its arguments, and each
+// OUTPUT records the expanded polynomial of its variable. The outputs are
+// then compiled, so running the program is one compiled evaluation per
+// OUTPUT instead of interpreting every statement.
+
+void Parser::enable_closed_form(size_t max_terms)
+{
+    closed_form_mode = true;
+    closed_form_max_terms = max_terms;
+}
+
+void Parser::begin_symbolic(size_t num_vars, size_t max_terms)
+{
+    symbolic_vars = num_vars;
+    symbolic_max_terms = max_terms;
+    saved_max_terms = max_expanded_terms;
+    max_expanded_terms = max_terms;
+}
+
+void Parser::end_symbolic()
+{
+    max_expanded_terms = saved_max_terms;
+}
+
+MonomialMap Parser::symbolic_constant(int value)
+{
+    MonomialMap constant;
+    if (value != 0)
+    {
+        constant[vector<int>(symbolic_vars, 0)] = value;
+    }
+    return constant;
+}
+
+// Term pairs one symbolic product may multiply, as a multiple of the
+// symbolic term budget. A product can fold down to few terms and still
+// take a long time to form, so the work is bounded as well as the size.
+static const size_t SYMBOLIC_WORK_FACTOR = 16;
+
+MonomialMap Parser::symbolic_multiply(const MonomialMap &a, const MonomialMap &b)
+{
+    if (a.size() * b.size() > symbolic_max_terms * SYMBOLIC_WORK_FACTOR)
+    {
+        throw ExpansionLimitExceeded{symbolic_max_terms};
+    }
+    return multiply_expansions(a, b);
+}
+
+MonomialMap Parser::symbolic_power(const MonomialMap &base, int exp)
+{
+    MonomialMap result = symbolic_constant(1);
+    MonomialMap square = base;
+    for (int e = exp; e > 0; e >>= 1)
+    {
+        if (e & 1)
+        {
+            result = symbolic_multiply(result, square);
+        }
+        if (e > 1)
+        {
+            square = symbolic_multiply(square, square);
+        }
+    }
+    return result;
+}
+
+MonomialMap Parser::symbolic_body(PolyBody *body, const vector<MonomialMap> &args)
+{
+    MonomialMap total;
+    for (auto &term_pair : body->terms)
+    {
+        Term *term = term_pair.second;
+        int sign = (term_pair.first == '+') ? 1 : -1;
+
+        MonomialMap value = symbolic_constant(term->coefficient);
+        for (size_t i = 0; i < term->monomial_power_vector.size() && !value.empty(); ++i)
+        {
+            if (term->monomial_power_vector[i] > 0)
+            {
+                value = symbolic_multiply(value, symbolic_power(args[i], term->monomial_power_vector[i]));
+            }
+        }
+        for (size_t i = 0; i < term->parenthesized_lists.size() && !value.empty(); ++i)
+        {
+            value = symbolic_multiply(value, symbolic_body(term->parenthesized_lists[i], args));
+        }
+        add_expansion(total, value, sign);
+    }
+    return total;
+}
+
+// symbolic_body with the arguments of a call. A repeated parameter name
+// takes the last argument given for it, as in the int evaluator's
+// name-to-value map.
+MonomialMap Parser::symbolic_call(const Polynomial &poly, const vector<MonomialMap> &args)
+{
+    vector<MonomialMap> by_position(poly.parameters.size());
+    for (size_t i = 0; i < poly.parameters.size(); ++i)
+    {
+        for (size_t j = 0; j < args.size(); ++j)
+        {
+            if (poly.parameters[j] == poly.parameters[i])
+            {
+                by_position[i] = args[j];
+            }
+        }
+    }
+    return symbolic_body(poly.body, by_position);
+}
+
+MonomialMap Parser::symbolic_poly_eval(PolyEval *pe, const vector<MonomialMap> &sym_mem)
+{
+    const Polynomial &poly = symbolTable.at(pe->poly_name);
+    vector<MonomialMap> args;
+    for (Value *arg : pe->arguments)
+    {
+        args.push_back(symbolic_value(arg, sym_mem));
+    }
+    return symbolic_call(poly, args);
+}
+
+MonomialMap Parser::symbolic_value(Value *v, const vector<MonomialMap> &sym_mem)
+{
+    MonomialMap value;
+    switch (v->type)
+    {
+    case NUM_TYPE:
+        value = symbolic_constant(v->value);
+        break;
+    case ID_TYPE:
+        value = sym_mem[v->location];
+        break;
+    case POLY_EVAL_TYPE:
+        value = symbolic_poly_eval(v->poly_eval, sym_mem);
+        break;
+    }
+    return value;
+}
+
+bool Parser::compile_closed_forms()
+{
+    closed_form_inputs = 0;
+    for (StatementNode *stmt : program)
+    {
+        if (stmt->type == INPUT_STMT)
+        {
+            closed_form_inputs++;
+        }
+    }
+
+    // Closed forms only pay off while they stay small, so they get their
+    // own, tighter term budget.
+    begin_symbolic(closed_form_inputs, closed_form_max_terms);
+
+    // Memory starts out zero, which is the empty polynomial.
+    vector<MonomialMap> sym_mem(mem.size());
+    vector<MonomialMap> outputs;
+    size_t input_index = 0;
+    try
+    {
+        for (StatementNode *stmt : program)
+        {
+            int location = stmt->location;
+            switch (stmt->type)
+            {
+            case INPUT_STMT:
+            {
+                vector<int> powers(symbolic_vars, 0);
+                powers[input_index++] = 1;
+                sym_mem[location].clear();
+                sym_mem[location][powers] = 1;
+                break;
+            }
+            case OUTPUT_STMT:
+                outputs.push_back(sym_mem[location]);
+                break;
+            case ASSIGN_STMT:
+                sym_mem[location] = symbolic_poly_eval(stmt->poly_eval, sym_mem);
+                break;
+            case COPY_STMT:
+                sym_mem[location] = symbolic_value(stmt->value, sym_mem);
+                break;
+            }
+        }
+    }
+    catch (const ExpansionLimitExceeded &e)
+    {
+        end_symbolic();
+        return false;
+    }
+    end_symbolic();
+
+    closed_forms.clear();
+    for (const MonomialMap &output : outputs)
+    {
+        closed_forms.push_back(compile_monomials(output, closed_form_inputs));
+    }
+    return true;
+}
+
+void Parser::execute_closed_forms(const vector<int> &input_values)
+{
+    for (const CompiledPoly &output : closed_forms)
+    {
+        output_stream << eval_compiled(output, input_values.data()) << endl;
+    }
+}
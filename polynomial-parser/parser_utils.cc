@@ -4,13 +4,22 @@
 #include "parser.h"
 #include <vector>
 #include <map>
+#include <sstream>
 
 using namespace std;
 
+Parser::Parser() : Parser(cin, cout, cerr)
+{
+}
+
+Parser::Parser(istream &program, ostream &output, ostream &diagnostics)
+    : lexer(program), output_stream(output), error_stream(diagnostics)
+{
+}
+
 void Parser::syntax_error()
 {
-    cout << "SYNTAX ERROR !!!!!&%!!!!&%!!!!!!" << endl;
-    exit(1);
+    throw ProgramError{PROGRAM_SYNTAX_ERROR, "SYNTAX ERROR !!!!!&%!!!!&%!!!!!!\n"};
 }
 
 Token Parser::expect(TokenType expected_type)
@@ -29,18 +38,19 @@ void Parser::report_errors()
     }
 
     // The map iterator will give us errors in alphabetical order by key
+    ostringstream report;
     for (map<string, vector<int>>::const_iterator it = errors.begin(); it != errors.end(); ++it)
     {
-        cout << "Semantic Error Code " << it->first << ": ";
+        report << "Semantic Error Code " << it->first << ": ";
         vector<int> line_nums = it->second;
         sort(line_nums.begin(), line_nums.end());
         for (size_t i = 0; i < line_nums.size(); ++i)
         {
-            cout << line_nums[i] << (i == line_nums.size() - 1 ? "" : " ");
+            report << line_nums[i] << (i == line_nums.size() - 1 ? "" : " ");
         }
-        cout << endl;
+        report << endl;
     }
-    exit(1); // Exit after reporting errors
+    throw ProgramError{PROGRAM_SEMANTIC_ERROR, report.str()};
 }
 
 int Parser::get_location(const std::string &id)
@@ -53,3 +63,8 @@ int Parser::get_location(const std::string &id)
     }
     return location_table[id];
 }
+
+void Parser::enable_memo(size_t max_entries)
+{
+    memo.reset(new MemoCache(max_entries));
+}
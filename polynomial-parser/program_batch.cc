@@ -0,0 +1,87 @@
+#include "parser.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Batch mode: many program files in one process. Each program gets its own
+// parser, reading from its file and printing into strings, and runs as one
+// task on the pool; the parsers themselves stay single-threaded. Programs
+// are taken BATCH_WINDOW_PER_THREAD per thread at a time, and each window is
+// written out, file by file, before the next one starts, so the output does
+// not depend on which task finishes first.
+
+static const size_t BATCH_WINDOW_PER_THREAD = 4;
+
+struct ProgramResult
+{
+    bool opened = false;
+    ProgramStatus status = PROGRAM_OK;
+    string output;
+    string diagnostics;
+};
+
+static ProgramResult run_program_file(const string &path, const vector<ParserSetting> &settings)
+{
+    ProgramResult result;
+    ifstream program(path);
+    if (!program)
+    {
+        return result;
+    }
+    result.opened = true;
+    ostringstream output;
+    ostringstream diagnostics;
+    Parser parser(program, output, diagnostics);
+    for (const ParserSetting &setting : settings)
+    {
+        setting(parser);
+    }
+    result.status = parser.RunProgram();
+    result.output = output.str();
+    result.diagnostics = diagnostics.str();
+    return result;
+}
+
+size_t run_program_batch(const vector<string> &paths, const vector<ParserSetting> &settings, unsigned num_threads)
+{
+    ThreadPool pool(num_threads == 0 ? 1 : num_threads);
+    size_t window = pool.size() * BATCH_WINDOW_PER_THREAD;
+    vector<ProgramResult> results;
+    size_t failed = 0;
+    for (size_t first = 0; first < paths.size(); first += window)
+    {
+        size_t last = min(paths.size(), first + window);
+        results.assign(last - first, ProgramResult());
+        {
+            TaskGroup group(pool);
+            for (size_t i = first; i < last; ++i)
+            {
+                ProgramResult &result = results[i - first];
+                const string &path = paths[i];
+                group.run([&result, &path, &settings]() { result = run_program_file(path, settings); });
+            }
+            group.wait();
+        }
+
+        for (size_t i = first; i < last; ++i)
+        {
+            const ProgramResult &result = results[i - first];
+            cout << "==> " << paths[i] << " <==" << endl;
+            if (!result.opened)
+            {
+                cerr << "cannot open program file " << paths[i] << endl;
+                ++failed;
+                continue;
+            }
+            cerr << result.diagnostics;
+            cout << result.output;
+            failed += (result.status != PROGRAM_OK);
+        }
+        cout.flush();
+    }
+    return failed;
+}
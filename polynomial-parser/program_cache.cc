@@ -0,0 +1,139 @@
+#include "program_cache.h"
+#include <cstdio>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+// Bumped whenever the payload layout changes, so stale images are misses.
+static const uint32_t PROGRAM_CACHE_VERSION = 1;
+static const char PROGRAM_CACHE_MAGIC[4] = {'P', 'P', 'C', 'F'};
+
+struct CacheHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t source_hash;
+    uint64_t payload_size;
+    uint64_t checksum;
+};
+
+static uint64_t fnv1a(const char *data, size_t size)
+{
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < size; ++i)
+    {
+        h = (h ^ (unsigned char)data[i]) * 1099511628211ULL;
+    }
+    return h;
+}
+
+ProgramCache::~ProgramCache()
+{
+    if (mapping)
+    {
+        munmap(mapping, mapping_size);
+    }
+}
+
+uint64_t ProgramCache::hash_source(const string &source)
+{
+    return fnv1a(source.data(), source.size());
+}
+
+string ProgramCache::path_for(const string &dir, uint64_t source_hash)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.ppc", (unsigned long long)source_hash);
+    return dir + "/" + name;
+}
+
+bool ProgramCache::open(const string &path, uint64_t source_hash)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(CacheHeader))
+    {
+        close(fd);
+        return false;
+    }
+    void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        return false;
+    }
+
+    CacheHeader header;
+    memcpy(&header, map, sizeof(header));
+    const char *data = (const char *)map + sizeof(header);
+    if (memcmp(header.magic, PROGRAM_CACHE_MAGIC, 4) != 0 || header.version != PROGRAM_CACHE_VERSION ||
+        header.source_hash != source_hash || header.payload_size != st.st_size - sizeof(header) ||
+        header.checksum != fnv1a(data, header.payload_size))
+    {
+        munmap(map, st.st_size);
+        return false;
+    }
+    mapping = map;
+    mapping_size = st.st_size;
+    return true;
+}
+
+const char *ProgramCache::payload() const
+{
+    return (const char *)mapping + sizeof(CacheHeader);
+}
+
+size_t ProgramCache::payload_size() const
+{
+    return mapping_size - sizeof(CacheHeader);
+}
+
+bool ProgramCache::save(const string &path, uint64_t source_hash, const string &payload)
+{
+    // Missing directories on the way are created; if one cannot be, the
+    // image cannot be written below.
+    size_t slash = path.rfind('/');
+    if (slash != string::npos && slash > 0)
+    {
+        string dir = path.substr(0, slash);
+        for (size_t next = dir.find('/', 1);; next = dir.find('/', next + 1))
+        {
+            mkdir(dir.substr(0, next).c_str(), 0755);
+            if (next == string::npos)
+            {
+                break;
+            }
+        }
+    }
+
+    CacheHeader header;
+    memcpy(header.magic, PROGRAM_CACHE_MAGIC, 4);
+    header.version = PROGRAM_CACHE_VERSION;
+    header.source_hash = source_hash;
+    header.payload_size = payload.size();
+    header.checksum = fnv1a(payload.data(), payload.size());
+
+    string temp = path + ".tmp" + to_string(getpid());
+    FILE *f = fopen(temp.c_str(), "wb");
+    if (!f)
+    {
+        return false;
+    }
+    bool written = fwrite(&header, sizeof(header), 1, f) == 1 &&
+                   fwrite(payload.data(), 1, payload.size(), f) == payload.size();
+    written = (fclose(f) == 0) && written;
+    if (!written || rename(temp.c_str(), path.c_str()) != 0)
+    {
+        remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,133 @@
+#ifndef __PROGRAM_CACHE_H__
+#define __PROGRAM_CACHE_H__
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// On-disk image of a parsed and checked program, named after a hash of its
+// source text. The file is a fixed header (magic, format version, source
+// hash, payload size and checksum) followed by the payload, a flat stream
+// of 32-bit words and length-prefixed strings written by the parser. A
+// cache file is memory-mapped and read in place; any mismatch in the
+// header or checksum makes it a miss.
+class ProgramCache
+{
+public:
+    ProgramCache() = default;
+    ~ProgramCache();
+    ProgramCache(const ProgramCache &) = delete;
+    ProgramCache &operator=(const ProgramCache &) = delete;
+
+    static uint64_t hash_source(const std::string &source);
+    static std::string path_for(const std::string &dir, uint64_t source_hash);
+
+    // Maps the file at path if it is a valid image of the given source.
+    bool open(const std::string &path, uint64_t source_hash);
+    bool is_open() const { return mapping != nullptr; }
+    const char *payload() const;
+    size_t payload_size() const;
+
+    // Writes a new image next to path and renames it into place, so
+    // concurrent runs never see a partial file. Creates missing directories.
+    static bool save(const std::string &path, uint64_t source_hash, const std::string &payload);
+
+private:
+    void *mapping = nullptr;
+    size_t mapping_size = 0;
+};
+
+// Appends words and strings to a payload.
+class CacheWriter
+{
+public:
+    void put(int value)
+    {
+        int32_t word = value;
+        out.append((const char *)&word, sizeof(word));
+    }
+    void put(const std::string &s)
+    {
+        put((int)s.size());
+        out += s;
+    }
+    void put(const std::vector<int> &values)
+    {
+        put((int)values.size());
+        for (int value : values)
+        {
+            put(value);
+        }
+    }
+    const std::string &str() const { return out; }
+
+private:
+    std::string out;
+};
+
+// Reads a payload back. Reading past the end yields zeros and marks the
+// reader as failed instead of touching memory outside the mapping; so does
+// a count the rest of the payload cannot hold, or a failed check.
+class CacheReader
+{
+public:
+    CacheReader(const char *data, size_t size) : p(data), end(data + size) {}
+
+    int get_int()
+    {
+        int32_t word = 0;
+        if ((size_t)(end - p) < sizeof(word))
+        {
+            overrun = true;
+            return 0;
+        }
+        memcpy(&word, p, sizeof(word));
+        p += sizeof(word);
+        return word;
+    }
+    std::string get_string()
+    {
+        size_t size = (size_t)get_int();
+        if ((size_t)(end - p) < size)
+        {
+            overrun = true;
+            return std::string();
+        }
+        std::string s(p, size);
+        p += size;
+        return s;
+    }
+    // A count of items that take at least one word each.
+    size_t get_count()
+    {
+        int count = get_int();
+        if (count < 0 || (size_t)count > (size_t)(end - p) / sizeof(int32_t))
+        {
+            overrun = true;
+            return 0;
+        }
+        return count;
+    }
+    std::vector<int> get_ints()
+    {
+        size_t count = get_count();
+        std::vector<int> values;
+        for (size_t i = 0; i < count && !overrun; ++i)
+        {
+            values.push_back(get_int());
+        }
+        return values;
+    }
+    void fail() { overrun = true; }
+    bool failed() const { return overrun; }
+    bool ok() const { return !overrun && p == end; }
+
+private:
+    const char *p;
+    const char *end;
+    bool overrun = false;
+};
+
+#endif
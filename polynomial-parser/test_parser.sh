@@ -0,0 +1,447 @@
+#!/bin/bash
+
+# Runs every tests/testNN.txt program through the parser and compares what
+# it prints with tests/testNN.txt.expected. A tests/testNN.txt.args file
+# holds options that test always runs with.
+#
+# Every entry of MODES is a LABEL=OPTIONS pair naming options that must
+# not change the output. Each program is run once per mode and compared
+# byte for byte with tests/testNN.txt.expected.LABEL if it exists, and
+# otherwise with the output of the plain run. A LABEL-VARIANT mode shares
+# the expected output of LABEL.
+#
+# Usage: ./test_parser.sh [binary]    (default ./polynomial-parser)
+
+SCRIPT_DIR=$( cd -- "$( dirname -- "${BASH_SOURCE[0]}" )" &> /dev/null && pwd )
+cd "$SCRIPT_DIR"
+
+BIN=${1:-./polynomial-parser}
+if [ ! -x "$BIN" ]; then
+    echo "Error: $BIN not found or not executable!"
+    exit 1
+fi
+BIN=$(cd "$(dirname "$BIN")" && pwd)/$(basename "$BIN")
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+MODES=(
+    "plain="
+    "threads2=--threads=2"
+    "threads4=--threads=4"
+    "memo=--memo"
+    "memo1=--memo=1"
+    "closed=--closed-form"
+    "closed1=--closed-form=1"
+    "fold=--fold"
+    "dce=--dce"
+    "cse=--cse"
+    "O=-O"
+    "Othreads=-O --threads=4"
+    "memothreads=--memo --threads=4"
+    "checked64=--numeric=checked64"
+    "checked64-threads=--numeric=checked64 --threads=4"
+    "bigint=--numeric=bigint"
+    "bigint-threads=--numeric=bigint --threads=4"
+    "mod=--modulus=1000000007"
+    "mod-threads=--modulus=1000000007 --threads=4"
+    "modbig=--modulus=9223372036854775783"
+    "native=--native=$WORK/native"
+    "native-O=-O --native=$WORK/native"
+)
+
+# check_run reports on fd 3, as its callers redirect the command's output.
+exec 3>&1
+
+let passed=0
+let failed=0
+
+# check NAME EXPECTED-FILE ACTUAL-FILE
+check()
+{
+    if cmp -s "$2" "$3"; then
+        passed=$((passed+1))
+    else
+        failed=$((failed+1))
+        echo "$1: output does not match $2"
+        echo "--------------------------------------------------------"
+        diff "$2" "$3" | head -20
+        echo "========================================================"
+    fi
+}
+
+for test_file in tests/test*.txt; do
+    name=$(basename "$test_file" .txt)
+    args=$(cat "$test_file.args" 2> /dev/null)
+    for mode in "${MODES[@]}"; do
+        label=${mode%%=*}
+        expected=$test_file.expected
+        if [ -e "$expected.${label%%-*}" ]; then
+            expected=$expected.${label%%-*}
+        fi
+        "$BIN" $args ${mode#*=} < "$test_file" > "$WORK/out" 2> /dev/null
+        check "$name ($label)" "$expected" "$WORK/out"
+    done
+done
+
+# check_run NAME COMMAND...: COMMAND must exit normally; a crash or an
+# error fails the test however its output compares.
+check_run()
+{
+    local name=$1
+    shift
+    if ! "$@"; then
+        failed=$((failed+1))
+        echo "$name: $1 failed" >&3
+        return 1
+    fi
+}
+
+# sweep_program BODY FIRST COUNT: a program whose INPUTS are COUNT values
+# of the polynomial P(x) = BODY, starting at the FIRST-th.
+sweep_program()
+{
+    echo "TASKS 2"
+    echo "POLY"
+    echo "P(x) = $1;"
+    echo "EXECUTE"
+    echo "INPUT a;"
+    echo "INPUTS"
+    seq $((7919 * $2)) 7919 $((7919 * ($2 + $3 - 1)))
+}
+
+# sweep_check NAME BODY COUNT: a sweep over COUNT inputs must print the
+# same values as sweeps over chunks of the inputs too short for the
+# subproduct tree.
+sweep_check()
+{
+    sweep_program "$2" 0 "$3" > "$WORK/sweep.txt"
+    check_run "$1 (sweep)" "$BIN" --sweep=P < "$WORK/sweep.txt" > "$WORK/out" 2> /dev/null || return
+    : > "$WORK/sweep.expected"
+    for ((first = 0; first < $3; first += 1000)); do
+        sweep_program "$2" $first $(($3 - first < 1000 ? $3 - first : 1000)) > "$WORK/sweep.txt"
+        check_run "$1 (sweep)" "$BIN" --sweep=P < "$WORK/sweep.txt" >> "$WORK/sweep.expected" 2> /dev/null || return
+    done
+    check "$1 (sweep)" "$WORK/sweep.expected" "$WORK/out"
+}
+
+sweep_check sweep-small "x^5 - 3 x^2 + 2000000000 x + 7" 40000
+sweep_check sweep-tree "(x^40000 + 3 x^17 - 1)(x^3 - 2 x + 5) + 9 x^32767" 40000
+
+# bench_check TEST NAME...: the batch kernels must agree with the tree
+# evaluator on every named polynomial of TEST.
+bench_check()
+{
+    local test_file=tests/$1.txt
+    shift
+    for name in "$@"; do
+        check_run "$name (bench-batch)" "$BIN" --bench-batch=$name:5000 < "$test_file" > "$WORK/out" 2>&1 || continue
+        echo "results match" > "$WORK/bench.expected"
+        grep -x "results match" "$WORK/out" > "$WORK/bench.out"
+        check "$name (bench-batch)" "$WORK/bench.expected" "$WORK/bench.out"
+    done
+}
+
+bench_check test14 A B C D E
+bench_check test17 F G H
+bench_check test23 A B C D E F G H I J
+
+# stream_check TEST LINES: --stream over LINES batches of random inputs, some
+# shorter than the INPUT statements of TEST, must print what plain runs of
+# TEST with each batch as its INPUTS print, in every streaming mode.
+stream_check()
+{
+    local test_file=tests/$1.txt
+    : > "$WORK/batches"
+    : > "$WORK/stream.expected"
+    for ((line = 0; line < $2; ++line)); do
+        batch=$(for ((i = RANDOM % 5; i > 0; --i)); do echo -n "$((RANDOM % 100)) "; done)
+        echo "$batch" >> "$WORK/batches"
+        sed '/^INPUTS/,$d' "$test_file" > "$WORK/program.txt"
+        # An empty INPUTS section does not parse; a single zero reads the
+        # same as no inputs at all.
+        echo "INPUTS ${batch:-0}" >> "$WORK/program.txt"
+        check_run "$1 (stream)" "$BIN" < "$WORK/program.txt" >> "$WORK/stream.expected" 2> /dev/null || return
+    done
+    for options in "" "--threads=4" "--closed-form" "-O --threads=2" "--native=$WORK/native"; do
+        check_run "$1 (stream $options)" "$BIN" --stream="$WORK/batches" $options < "$test_file" > "$WORK/out" 2> /dev/null || continue
+        check "$1 (stream $options)" "$WORK/stream.expected" "$WORK/out"
+        check_run "$1 (stream - $options)" "$BIN" --stream=- $options "$test_file" < "$WORK/batches" > "$WORK/out" 2> /dev/null || continue
+        check "$1 (stream - $options)" "$WORK/stream.expected" "$WORK/out"
+    done
+}
+
+stream_check test17 50
+stream_check test18 50
+stream_check test20 20
+stream_check test23 20
+
+# session_check TEST LINES: a --session over TEST must print what plain runs
+# of TEST print, first on its own INPUTS and then on each of LINES batches.
+# Batches repeat, extend and shorten each other so that reruns reuse some
+# assignments and recompute others.
+session_check()
+{
+    local test_file=tests/$1.txt
+    : > "$WORK/batches"
+    "$BIN" < "$test_file" > "$WORK/session.expected" 2> /dev/null
+    batch="1 2"
+    for ((line = 0; line < $2; ++line)); do
+        case $((RANDOM % 4)) in
+        0) batch="$batch $((RANDOM % 100))" ;;
+        1) batch=${batch% *} ;;
+        2) batch="$((RANDOM % 100)) ${batch#* }" ;;
+        esac
+        echo "$batch" >> "$WORK/batches"
+        sed '/^INPUTS/,$d' "$test_file" > "$WORK/program.txt"
+        echo "INPUTS $batch" >> "$WORK/program.txt"
+        check_run "$1 (session)" "$BIN" < "$WORK/program.txt" >> "$WORK/session.expected" 2> /dev/null || return
+    done
+    for options in "" "--threads=4" "-O"; do
+        check_run "$1 (session $options)" "$BIN" --session $options "$test_file" < "$WORK/batches" > "$WORK/out" 2> /dev/null || continue
+        check "$1 (session $options)" "$WORK/session.expected" "$WORK/out"
+    done
+}
+
+session_check test17 50
+session_check test18 50
+session_check test20 20
+
+# fnv1a FILE: the checksum of a program cache payload.
+fnv1a()
+{
+    local h=1469598103934665603
+    for byte in $(od -An -v -tu1 "$1"); do
+        h=$(( (h ^ byte) * 1099511628211 ))
+    done
+    echo $h
+}
+
+# le64 N: N as eight little-endian bytes.
+le64()
+{
+    for ((i = 0; i < 64; i += 8)); do
+        printf "\\x$(printf %02x $(( ($1 >> i) & 255 )))"
+    done
+}
+
+# reseal IMAGE PAYLOAD: replaces the payload of a program cache image and
+# gives it a matching size and checksum, so only decoding can reject it.
+reseal()
+{
+    head -c 16 "$1" > "$WORK/sealed"
+    le64 $(stat -c %s "$2") >> "$WORK/sealed"
+    le64 $(fnv1a "$2") >> "$WORK/sealed"
+    cat "$2" >> "$WORK/sealed"
+    mv "$WORK/sealed" "$1"
+}
+
+# cache_check TEST: a cold and a warm --cache-dir run of TEST must print its
+# expected output, creating the missing directories on the way. So must a
+# run over an image that passes its checksum but does not decode, which
+# rewrites the image.
+cache_check()
+{
+    local test_file=tests/$1.txt
+    local dir=$WORK/cache/$1/images
+    for run in cold warm; do
+        check_run "$1 (cache $run)" "$BIN" --cache-dir="$dir" < "$test_file" > "$WORK/out" 2> /dev/null || return
+        check "$1 (cache $run)" "$test_file.expected" "$WORK/out"
+    done
+    local image=$(ls "$dir"/*.ppc)
+    cp "$image" "$WORK/image.good"
+    tail -c +33 "$WORK/image.good" > "$WORK/payload"
+    # The last word of the payload is the location of the last statement.
+    for damage in truncated bad-location; do
+        if [ $damage = truncated ]; then
+            head -c -4 "$WORK/payload" > "$WORK/damaged"
+        else
+            { head -c -4 "$WORK/payload"; printf '\xff\xff\xff\x7f'; } > "$WORK/damaged"
+        fi
+        reseal "$image" "$WORK/damaged"
+        check_run "$1 (cache $damage)" "$BIN" --cache-dir="$dir" < "$test_file" > "$WORK/out" 2> /dev/null || continue
+        check "$1 (cache $damage)" "$test_file.expected" "$WORK/out"
+        check "$1 (cache $damage rewritten)" "$WORK/image.good" "$image"
+    done
+}
+
+cache_check test17
+cache_check test22
+
+# serve_client SOCKET: sends stdin to the server on SOCKET and prints the
+# replies.
+serve_client()
+{
+    python3 -c '
+import socket, sys
+s = socket.socket(socket.AF_UNIX)
+s.connect(sys.argv[1])
+s.sendall(sys.stdin.buffer.read())
+s.shutdown(socket.SHUT_WR)
+while True:
+    data = s.recv(65536)
+    if not data:
+        break
+    sys.stdout.buffer.write(data)
+' "$1"
+}
+
+# serve_check TEST LINES: RUN requests for LINES batches of random inputs
+# must be answered with what plain runs of TEST print, in request order.
+# --serve must refuse a PATH that holds anything but a socket and leave it
+# alone, and must replace a stale socket and remove its own at shutdown.
+serve_check()
+{
+    local test_file=tests/$1.txt
+    : > "$WORK/requests"
+    : > "$WORK/serve.expected"
+    for ((line = 0; line < $2; ++line)); do
+        batch=$(for ((i = RANDOM % 5 + 1; i > 0; --i)); do echo -n "$((RANDOM % 100)) "; done)
+        echo "RUN $batch" >> "$WORK/requests"
+        sed '/^INPUTS/,$d' "$test_file" > "$WORK/program.txt"
+        echo "INPUTS $batch" >> "$WORK/program.txt"
+        check_run "$1 (serve)" "$BIN" < "$WORK/program.txt" > "$WORK/out" 2> /dev/null || return
+        echo "OK" $(cat "$WORK/out") >> "$WORK/serve.expected"
+    done
+    for options in "" "--threads=4" "-O" "--native=$WORK/native"; do
+        check_run "$1 (serve - $options)" "$BIN" --serve=- $options "$test_file" < "$WORK/requests" > "$WORK/out" 2> /dev/null || continue
+        check "$1 (serve - $options)" "$WORK/serve.expected" "$WORK/out"
+    done
+
+    echo "not a socket" > "$WORK/victim"
+    cp "$WORK/victim" "$WORK/victim.expected"
+    if "$BIN" --serve="$WORK/victim" "$test_file" > /dev/null 2>&1; then
+        failed=$((failed+1))
+        echo "$1 (serve refuses a regular file): the server started"
+    fi
+    check "$1 (serve refuses a regular file)" "$WORK/victim.expected" "$WORK/victim"
+
+    if ! command -v python3 > /dev/null; then
+        return
+    fi
+    local sock=$WORK/serve.sock
+    # A socket left behind by a server that did not shut down.
+    python3 -c 'import socket, sys; socket.socket(socket.AF_UNIX).bind(sys.argv[1])' "$sock"
+    "$BIN" --serve="$sock" "$test_file" > /dev/null 2>&1 &
+    local server=$!
+    for ((i = 0; i < 100; ++i)); do
+        serve_client "$sock" < /dev/null > /dev/null 2>&1 && break
+        sleep 0.1
+    done
+    serve_client "$sock" < "$WORK/requests" > "$WORK/out" 2> /dev/null
+    check "$1 (serve socket)" "$WORK/serve.expected" "$WORK/out"
+    echo SHUTDOWN | serve_client "$sock" > /dev/null 2>&1
+    if ! wait $server; then
+        failed=$((failed+1))
+        echo "$1 (serve socket): the server failed"
+    elif [ -e "$sock" ]; then
+        failed=$((failed+1))
+        echo "$1 (serve socket): $sock was not removed"
+    else
+        passed=$((passed+1))
+    fi
+}
+
+serve_check test17 30
+serve_check test20 20
+serve_check test23 20
+
+# batch_check OPTIONS: --batch over every test that runs without options of
+# its own, some of which have errors, must print each expected output under
+# its header in argument order and exit with status 1.
+batch_check()
+{
+    local files=()
+    : > "$WORK/batch.expected"
+    for test_file in tests/test*.txt; do
+        if [ ! -e "$test_file.args" ]; then
+            files+=("$test_file")
+            echo "==> $test_file <==" >> "$WORK/batch.expected"
+            cat "$test_file.expected" >> "$WORK/batch.expected"
+        fi
+    done
+    "$BIN" --batch $1 "${files[@]}" > "$WORK/out" 2> /dev/null
+    if [ $? -ne 1 ]; then
+        failed=$((failed+1))
+        echo "batch ($1): exit status is not 1"
+    fi
+    check "batch ($1)" "$WORK/batch.expected" "$WORK/out"
+}
+
+batch_check --threads=1
+batch_check --threads=4
+batch_check "-O --threads=3"
+
+# slow_cat FILE SIZE: writes FILE in SIZE-byte chunks with a pause after
+# each, so the parser sees the program arrive piece by piece.
+slow_cat()
+{
+    while IFS= read -r -d '' -N $2 chunk || [ -n "$chunk" ]; do
+        printf %s "$chunk"
+        sleep 0.002
+    done < "$1"
+}
+
+# push_check OPTIONS: every test written to stdin in small chunks, cutting
+# through names, numbers and lines, must print its expected output.
+push_check()
+{
+    for test_file in tests/test*.txt; do
+        name=$(basename "$test_file" .txt)
+        args=$(cat "$test_file.args" 2> /dev/null)
+        size=$(( $(stat -c %s "$test_file") / 60 ))
+        slow_cat "$test_file" $(( size > 7 ? size : 7 )) | "$BIN" $args $1 > "$WORK/out" 2> /dev/null
+        check "$name (pushed $1)" "$test_file.expected" "$WORK/out"
+    done
+}
+
+push_check
+push_check --threads=4
+
+# native_check OPTIONS: a native build that differs from the interpreter
+# falls back to it, so the output alone cannot show a wrong build. Every
+# test must build with no report other than "native: built".
+native_check()
+{
+    : > "$WORK/native.expected"
+    for test_file in tests/test*.txt; do
+        name=$(basename "$test_file" .txt)
+        args=$(cat "$test_file.args" 2> /dev/null)
+        "$BIN" $args $1 --native="$WORK/native-check" < "$test_file" > /dev/null 2> "$WORK/err"
+        grep '^native:' "$WORK/err" | grep -v '^native: built ' > "$WORK/out"
+        check "$name (native build $1)" "$WORK/native.expected" "$WORK/out"
+    done
+}
+
+native_check
+native_check -O
+
+# Lists far longer than the parser's stack could hold one frame per element:
+# a body of COUNT terms and COUNT INPUT and OUTPUT statements reading COUNT
+# inputs.
+long_lists_check()
+{
+    {
+        echo "TASKS 2"
+        echo "POLY"
+        echo -n "F(x) = x"
+        for ((i = 1; i < $1; ++i)); do echo -n " + x"; done
+        echo ";"
+        echo "EXECUTE"
+        for ((i = 0; i < $1; ++i)); do echo "INPUT a;"; echo "OUTPUT a;"; done
+        echo "b = F(1);"
+        echo "OUTPUT b;"
+        echo "INPUTS"
+        seq 1 $1
+    } > "$WORK/long.txt"
+    { seq 1 $1; echo $1; } > "$WORK/long.expected"
+    check_run "long-lists" "$BIN" < "$WORK/long.txt" > "$WORK/out" 2> /dev/null || return
+    check "long-lists" "$WORK/long.expected" "$WORK/out"
+}
+
+long_lists_check 200000
+
+echo
+echo "Passed $passed checks out of $((passed+failed))"
+echo
+[ "$failed" -eq 0 ]
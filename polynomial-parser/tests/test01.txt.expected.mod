@@ -0,0 +1,19 @@
+19
+161
+712813
+1772927
+POLY - SORTED MONOMIAL LISTS
+    F1 = x^2 + 3x + 1 ;
+    G(x,y) = 2x^2y + (x + y)(x - y) - 3y^2 + 4x^2y ;
+    H(a,b,c) = (a + b + c)(a - 1)(b + 2c) - 5 ;
+    K = (x + 1)(x + 1)(x + 1)(x - 1) + 2x ;
+POLY - COMBINED MONOMIAL LISTS
+    F1 = x^2 + 3x + 1 ;
+    G(x,y) = 6x^2y + (x + y)(x - y) - 3y^2 ;
+    H(a,b,c) = (a + b + c)(a - 1)(b + 2c) - 5 ;
+    K = (x + 1)(x + 1)(x + 1)(x - 1) + 2x ;
+POLY - EXPANDED
+    F1 = x^2 + 3x + 1 ;
+    G(x,y) = 6x^2y + x^2 + 1000000003y^2 ;
+    H(a,b,c) = a^2b + 2a^2c + ab^2 + 3abc + 2ac^2 + 1000000006ab + 1000000005ac + 1000000006b^2 + 1000000004bc + 1000000005c^2 + 1000000002 ;
+    K = x^4 + 2x^3 + 1000000006 ;
@@ -0,0 +1,3 @@
+999999707
+999988331
+872440301
@@ -0,0 +1,16 @@
+10
+10
+20
+70
+POLY - SORTED MONOMIAL LISTS
+    F(x,x) = x^2 + 3x ;
+    G(a,b,a) = ab + 2a^3 - (a + b)(a - b) ;
+    H(a,b) = b^2 + 3b ;
+POLY - COMBINED MONOMIAL LISTS
+    F(x,x) = x^2 + 3x ;
+    G(a,b,a) = ab + 2a^3 - (a + b)(a - b) ;
+    H(a,b) = b^2 + 3b ;
+POLY - EXPANDED
+    F(x,x) = x^2 + 3x ;
+    G(a,b,a) = 2a^3 + 1000000006a^2 + ab + b^2 ;
+    H(a,b) = b^2 + 3b ;
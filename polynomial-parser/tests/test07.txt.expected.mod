@@ -0,0 +1,6 @@
+109505789
+796006727
+347548056
+POLY - EXPANDED
+    P(x) = x^7 + 3x^5 + 999000007x^3 + 123456789 ;
+    Q(x,y) = 196x^2 + 999999811y^2 ;
@@ -0,0 +1,5 @@
+999983132
+205624486
+POLY - EXPANDED
+    P(x,y,z,w) = x^6 + 2x^5y + 2x^5z + 2x^5w + 1000000006x^4y^2 + 2x^4yz + 2x^4yw + 1000000006x^4z^2 + 2x^4zw + 1000000006x^4w^2 + 1000000003x^3y^3 + 1000000003x^3y^2z + 1000000003x^3y^2w + 1000000003x^3yz^2 + 8x^3yzw + 1000000003x^3yw^2 + 1000000003x^3z^3 + 1000000003x^3z^2w + 1000000003x^3zw^2 + 1000000003x^3w^3 + 1000000006x^2y^4 + 1000000003x^2y^3z + 1000000003x^2y^3w + 1000000001x^2y^2z^2 + 12x^2y^2zw + 1000000001x^2y^2w^2 + 1000000003x^2yz^3 + 12x^2yz^2w + 12x^2yzw^2 + 1000000003x^2yw^3 + 1000000006x^2z^4 + 1000000003x^2z^3w + 1000000001x^2z^2w^2 + 1000000003x^2zw^3 + 1000000006x^2w^4 + 2xy^5 + 2xy^4z + 2xy^4w + 1000000003xy^3z^2 + 8xy^3zw + 1000000003xy^3w^2 + 1000000003xy^2z^3 + 12xy^2z^2w + 12xy^2zw^2 + 1000000003xy^2w^3 + 2xyz^4 + 8xyz^3w + 12xyz^2w^2 + 8xyzw^3 + 2xyw^4 + 2xz^5 + 2xz^4w + 1000000003xz^3w^2 + 1000000003xz^2w^3 + 2xzw^4 + 2xw^5 + y^6 + 2y^5z + 2y^5w + 1000000006y^4z^2 + 2y^4zw + 1000000006y^4w^2 + 1000000003y^3z^3 + 1000000003y^3z^2w + 1000000003y^3zw^2 + 1000000003y^3w^3 + 1000000006y^2z^4 + 1000000003y^2z^3w + 1000000001y^2z^2w^2 + 1000000003y^2zw^3 + 1000000006y^2w^4 + 2yz^5 + 2yz^4w + 1000000003yz^3w^2 + 1000000003yz^2w^3 + 2yzw^4 + 2yw^5 + z^6 + 2z^5w + 1000000006z^4w^2 + 1000000003z^3w^3 + 1000000006z^2w^4 + 2zw^5 + w^6 ;
+    Q(x,y) = x^8 + 4x^7y + 999999999x^6y^2 + 999999959x^5y^3 + 192x^3y^5 + 128x^2y^6 + 999999751xy^7 + 999999751y^8 + 6x^7 + 999999983x^6y + 999999791x^5y^2 + 1440x^3y^4 + 1152x^2y^5 + 999997319xy^6 + 999996935y^7 + 999999989x^6 + 999999683x^5y + 4320x^3y^3 + 4320x^2y^4 + 999987911xy^5 + 999983879y^6 + 999999845x^5 + 6480x^3y^2 + 8640x^2y^3 + 999969767xy^4 + 999951623y^5 + 4860x^3y + 9720x^2y^2 + 999954647xy^3 + 999909287y^4 + 1458x^3 + 5832x^2y + 999959183xy^2 + 999891143y^3 + 1458x^2 + 999979595xy + 999918359y^2 + 999995633x + 999965015y + 999993446 ;
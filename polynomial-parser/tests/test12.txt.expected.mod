@@ -0,0 +1,10 @@
+501816089
+6406572
+496641140
+965970194
+POLY - EXPANDED
+    K(x) = x^300 + 3x^277 + 1000000000x^250 + 1000000002x^240 + 999999986x^227 + 2x^201 + x^200 + 35x^190 + 999999993x^151 + 1000000000x^150 + 11x^131 + 33x^108 + 999999993x^100 + 999999965x^77 + 999999952x^71 + 70x^40 + 22x^32 + 11x^31 + 999999979x + 999999993 ;
+    N(x) = 5x^1513 + 3x^1500 + 7x^1301 + x^1300 + 1000000005x^1213 + 15x^1200 + 1000000006x^1115 + 999999993x^1114 + 9x^1113 + 35x^1001 + 5x^1000 + 1000000001x^900 + 1000000002x^815 + 999999937x^814 + 45x^813 + 1000000004x^802 + 999999965x^801 + 27x^800 + 999999993x^701 + 1000000005x^700 + 1000000000x^603 + 999999908x^602 + 49x^601 + 9x^600 + 2x^515 + 28x^514 + 999999989x^513 + 999999992x^502 + 999999797x^501 + 135x^500 + 999999972x^303 + 999999512x^302 + 245x^301 + 45x^300 + 6x^202 + 84x^201 + 999999953x^200 + 14x^3 + 198x^2 + 999999909x + 999999989 ;
+    B(t) = t^40 + 40t^39 + 780t^38 + 9880t^37 + 91390t^36 + 658008t^35 + 3838380t^34 + 18643560t^33 + 76904685t^32 + 273438880t^31 + 847660528t^30 + 311801426t^29 + 586853445t^28 + 33222796t^27 + 206929679t^26 + 225344776t^25 + 852101216t^24 + 732378184t^23 + 380261009t^22 + 282407483t^21 + 846527861t^20 + 282407483t^19 + 380261009t^18 + 732378184t^17 + 852101216t^16 + 225344776t^15 + 206929679t^14 + 33222796t^13 + 586853445t^12 + 311801426t^11 + 847660528t^10 + 273438880t^9 + 76904685t^8 + 18643560t^7 + 3838380t^6 + 658008t^5 + 91390t^4 + 9880t^3 + 780t^2 + 40t + 1 ;
+    Z(x) =  ;
+    C = x^75 + 1000000005x^74 + 999999999x^73 + x^42 + 2x^41 + 1000000006x^40 + 1000000005x^39 + 1000000006x^36 + 7x^35 + 999999995x^34 + 1000000006x^3 + 4x^2 + x + 1000000003 ;
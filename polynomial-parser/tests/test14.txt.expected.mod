@@ -0,0 +1,5 @@
+102113348
+458704449
+456919974
+159790543
+251129496
@@ -0,0 +1,9 @@
+3
+999999943
+90
+999999852
+30
+188
+999787139
+22
+1300
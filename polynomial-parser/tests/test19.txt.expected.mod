@@ -0,0 +1,10 @@
+37
+37
+7
+989
+919
+223
+223
+223
+927321425
+47915
@@ -0,0 +1,18 @@
+193018139
+84318702
+193019243
+571277266
+193026395
+302928609
+193124859
+178641120
+166
+1168
+4918
+9496
+2134
+999949143
+999782925
+999386175
+998573133
+997067991
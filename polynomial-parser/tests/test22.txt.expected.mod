@@ -0,0 +1,16 @@
+872737056
+416833034
+872737056
+872737056
+475243965
+805282655
+78590065
+POLY - EXPANDED
+    F(x,y) = x^2y^2 + x^3 + 5x^2y + 10xy^2 + 8y^3 + 999999998x^2 + 999999976xy + 999999971y^2 + 26x + 52y + 999999984 ;
+    G(x,y) = x^3y^2 + 2x^2y^3 + 1000000004x^2y^2 + 2x^2y + 4xy^2 + x^2 + 1000000005xy + 4y^2 + 1000000002x + 999999997y + 6 ;
+    H(a,b) = a^2b^2 + a^3 + 5a^2b + 10ab^2 + 8b^3 + 999999998a^2 + 999999976ab + 999999971b^2 + 26a + 52b + 999999984 ;
+    K(y,x) = y^2x^2 + 8y^3 + 10y^2x + 5yx^2 + x^3 + 999999971y^2 + 999999976yx + 999999998x^2 + 52y + 26x + 999999984 ;
+    L(x,y,x) = x^3 + x^2y + 1000000006xy^2 + 1000000006y^3 + x^2 + 2xy + y^2 ;
+    M(x) = x^4 + 6x^3 + 12x^2 + 10x + 3 ;
+POLY - IDENTITIES
+    F = H ;
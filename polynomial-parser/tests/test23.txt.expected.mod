@@ -0,0 +1,10 @@
+391953669
+761721914
+999861767
+790534186
+2123
+324913786
+536392640
+60329022
+731199214
+816570471
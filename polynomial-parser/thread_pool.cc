@@ -0,0 +1,173 @@
+#include "thread_pool.h"
+
+using namespace std;
+
+// The pool and queue index of the worker running on this thread, if any.
+static thread_local const ThreadPool *current_pool = nullptr;
+static thread_local unsigned current_index = 0;
+
+ThreadPool::ThreadPool(unsigned num_threads)
+{
+    for (unsigned i = 0; i <= num_threads; ++i)
+    {
+        queues.emplace_back(new TaskQueue());
+    }
+    for (unsigned i = 0; i < num_threads; ++i)
+    {
+        workers.emplace_back(&ThreadPool::worker_loop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> lock(sleep_mutex);
+        stopping = true;
+    }
+    sleep_cv.notify_all();
+    for (thread &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+unsigned ThreadPool::own_queue() const
+{
+    return current_pool == this ? current_index : queues.size() - 1;
+}
+
+void ThreadPool::submit(function<void()> task)
+{
+    // Count the task before it becomes visible, so a thief can never take
+    // it while the count is still zero.
+    queued++;
+    TaskQueue &queue = *queues[own_queue()];
+    {
+        lock_guard<mutex> lock(queue.mutex);
+        queue.tasks.push_back(move(task));
+    }
+    {
+        // Taking the lock orders this wake-up after a worker's last check
+        // of the queued count, so the wake-up cannot be lost.
+        lock_guard<mutex> lock(sleep_mutex);
+    }
+    sleep_cv.notify_one();
+}
+
+bool ThreadPool::take_task(unsigned self, function<void()> &task)
+{
+    // Newest task of our own deque first, then the oldest task of every
+    // other queue, starting with the shared one.
+    unsigned shared = queues.size() - 1;
+    if (self != shared)
+    {
+        TaskQueue &queue = *queues[self];
+        lock_guard<mutex> lock(queue.mutex);
+        if (!queue.tasks.empty())
+        {
+            task = move(queue.tasks.back());
+            queue.tasks.pop_back();
+            queued--;
+            return true;
+        }
+    }
+    for (unsigned k = 0; k < queues.size(); ++k)
+    {
+        unsigned victim = (shared + k) % queues.size();
+        if (victim == self)
+        {
+            continue;
+        }
+        TaskQueue &queue = *queues[victim];
+        lock_guard<mutex> lock(queue.mutex);
+        if (!queue.tasks.empty())
+        {
+            task = move(queue.tasks.front());
+            queue.tasks.pop_front();
+            queued--;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::run_pending_task()
+{
+    function<void()> task;
+    if (!take_task(own_queue(), task))
+    {
+        return false;
+    }
+    task();
+    return true;
+}
+
+void ThreadPool::worker_loop(unsigned index)
+{
+    current_pool = this;
+    current_index = index;
+    while (true)
+    {
+        function<void()> task;
+        if (take_task(index, task))
+        {
+            task();
+            continue;
+        }
+        unique_lock<mutex> lock(sleep_mutex);
+        sleep_cv.wait(lock, [this] { return stopping || queued.load() > 0; });
+        if (stopping && queued.load() == 0)
+        {
+            return; // stopping and drained
+        }
+    }
+}
+
+TaskGroup::~TaskGroup()
+{
+    // Tasks reference the group, so never let it go away under them.
+    while (pending.load() > 0)
+    {
+        if (!pool.run_pending_task())
+        {
+            this_thread::yield();
+        }
+    }
+}
+
+void TaskGroup::run(function<void()> task)
+{
+    pending++;
+    pool.submit([this, task]() {
+        try
+        {
+            task();
+        }
+        catch (...)
+        {
+            lock_guard<mutex> lock(error_mutex);
+            if (!error)
+            {
+                error = current_exception();
+            }
+        }
+        pending--;
+    });
+}
+
+void TaskGroup::wait()
+{
+    while (pending.load() > 0)
+    {
+        if (!pool.run_pending_task())
+        {
+            this_thread::yield();
+        }
+    }
+    if (error)
+    {
+        exception_ptr e = error;
+        error = nullptr;
+        rethrow_exception(e);
+    }
+}
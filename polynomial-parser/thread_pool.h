@@ -0,0 +1,71 @@
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads that run queued tasks. Every worker owns a
+// deque: tasks it submits go to the back of its own deque and it takes work
+// from the back, so related tasks stay on one thread. Tasks submitted from
+// other threads go to a shared queue. An idle worker steals from the front
+// of the other deques.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(unsigned num_threads);
+    ~ThreadPool();
+
+    unsigned size() const { return workers.size(); }
+    void submit(std::function<void()> task);
+
+    // Runs one queued task on the calling thread. Returns false if no
+    // task was queued.
+    bool run_pending_task();
+
+private:
+    struct TaskQueue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<TaskQueue>> queues; // One per worker, then the shared queue; fixed once workers start
+    std::atomic<size_t> queued{0};
+    std::mutex sleep_mutex;
+    std::condition_variable sleep_cv;
+    bool stopping = false;
+
+    unsigned own_queue() const;
+    bool take_task(unsigned self, std::function<void()> &task);
+    void worker_loop(unsigned index);
+};
+
+// A set of tasks submitted to a pool that can be waited on together.
+// wait() runs queued tasks while it waits, so groups may be nested inside
+// pool tasks without starving the pool. The first exception thrown by a
+// task is rethrown from wait().
+class TaskGroup
+{
+public:
+    explicit TaskGroup(ThreadPool &pool) : pool(pool) {}
+    ~TaskGroup();
+
+    void run(std::function<void()> task);
+    void wait();
+
+private:
+    ThreadPool &pool;
+    std::atomic<int> pending{0};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+};
+
+#endif